@@ -0,0 +1,206 @@
+#ifndef ADVENTURE_ANALYSIS_H
+#define ADVENTURE_ANALYSIS_H
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#include "adventure_map.h"
+
+// exact analysis of an adventure map treated as an absorbing markov chain.
+// a walk starts at some node and repeatedly picks an arc with probability proportional to its weight.
+// an arc whose dest is not a valid node (a terminal arc) ends the story at the node it was taken from,
+// as does reaching a node with no arcs (or whose arcs all have zero weight).
+
+// the results of analyze_endings()
+struct EndingAnalysis
+{
+    std::vector<double> visits;    // expected number of visits to each node
+    std::vector<double> end_prob;  // probability that the story ends at each node
+    std::vector<double> end_steps; // expected number of arcs taken before ending at each node (given that it ends there, 0 if it never does)
+
+    double expected_steps = 0; // expected number of arcs taken before the story ends (over all endings)
+    double unresolved = 0;     // probability mass that never reaches an ending (trapped in a cycle with no exit)
+
+    std::size_t iterations = 0; // number of solver sweeps performed
+    bool        converged = false; // true iff the solver reached the requested tolerance
+};
+
+// default arc weight functor - every arc is equally likely
+struct UniformArcWeight
+{
+    template<typename Arc>
+    double operator()(const Arc&) const { return 1; }
+};
+
+namespace adventure_analysis_detail
+{
+    // transposed (incoming) arc layout in compressed sparse row form.
+    // the arcs into node j are sources[offsets[j]..offsets[j+1]) with transition probabilities probs[...].
+    struct IncomingCSR
+    {
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> sources;
+        std::vector<double>      probs;
+
+        std::vector<double> self;     // probability of a node taking an arc to itself
+        std::vector<double> terminal; // probability of the story ending when at each node
+    };
+
+    template<typename NodePayload, typename ArcPayload, typename Columns, typename Weight>
+    IncomingCSR build_incoming(const AdventureMap<NodePayload, ArcPayload, Columns> &map, Weight &weight)
+    {
+        const std::size_t n = map.size();
+
+        IncomingCSR csr;
+        csr.offsets.assign(n + 1, 0);
+        csr.self.assign(n, 0);
+        csr.terminal.assign(n, 0);
+
+        // gather the total outgoing weight of each node and count incoming arcs
+        std::vector<double> total(n, 0);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (const auto &arc : map[i].arcs)
+            {
+                double w = weight(arc);
+                if (!(w > 0)) continue; // ignore zero/negative/nan weights
+
+                total[i] += w;
+                if (arc.dest < n && arc.dest != i) ++csr.offsets[arc.dest + 1];
+            }
+        }
+        for (std::size_t j = 0; j < n; ++j) csr.offsets[j + 1] += csr.offsets[j];
+
+        csr.sources.resize(csr.offsets[n]);
+        csr.probs.resize(csr.offsets[n]);
+
+        // scatter the normalized arcs into their destination rows
+        std::vector<std::size_t> fill(csr.offsets.begin(), csr.offsets.end() - 1);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            // nodes with nowhere to go are endings
+            if (total[i] <= 0) { csr.terminal[i] = 1; continue; }
+
+            for (const auto &arc : map[i].arcs)
+            {
+                double w = weight(arc);
+                if (!(w > 0)) continue;
+
+                double p = w / total[i];
+
+                if (arc.dest >= n) csr.terminal[i] += p;
+                else if (arc.dest == i) csr.self[i] += p;
+                else
+                {
+                    std::size_t k = fill[arc.dest]++;
+                    csr.sources[k] = i;
+                    csr.probs[k] = p;
+                }
+            }
+        }
+
+        return csr;
+    }
+
+    // solves x = b + P^T (x + c) by gauss-seidel sweeps over the incoming arcs, where P is the transient transition matrix.
+    // <c> may be null (treated as zero). returns the number of sweeps performed and sets <converged>.
+    // nodes that can never leave themselves (self probability of 1) are left at zero - their mass is unresolved.
+    inline std::size_t solve(const IncomingCSR &csr, const std::vector<double> &b, const double *c,
+                             std::vector<double> &x, double tolerance, std::size_t max_iterations, bool &converged)
+    {
+        const std::size_t n = b.size();
+        x.assign(n, 0);
+        converged = false;
+
+        std::size_t iter = 0;
+        while (iter < max_iterations)
+        {
+            ++iter;
+            double max_delta = 0, max_value = 0;
+
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                double leave = 1 - csr.self[j];
+                if (leave <= 0) continue;
+
+                // sum the contributions of all incoming arcs (self loops are folded into the divisor)
+                double sum = b[j];
+                if (c) sum += csr.self[j] * c[j];
+                for (std::size_t k = csr.offsets[j], _end = csr.offsets[j + 1]; k < _end; ++k)
+                {
+                    std::size_t i = csr.sources[k];
+                    sum += csr.probs[k] * (c ? x[i] + c[i] : x[i]);
+                }
+                sum /= leave;
+
+                max_delta = std::max(max_delta, std::abs(sum - x[j]));
+                max_value = std::max(max_value, std::abs(sum));
+                x[j] = sum;
+            }
+
+            // relative tolerance so very long expected walks still terminate
+            if (max_delta <= tolerance * std::max(1.0, max_value)) { converged = true; break; }
+        }
+
+        return iter;
+    }
+}
+
+// computes the exact ending distribution for a walk starting at node <start>.
+// <weight> is a functor taking an arc and returning its (non-negative) relative weight.
+// the solver performs gauss-seidel sweeps over the incoming arcs of each node, so a map whose nodes are mostly
+// stored in story order converges in very few sweeps. cost per sweep is linear in the number of arcs.
+// throws std::out_of_range if <start> is not a valid node.
+template<typename NodePayload, typename ArcPayload, typename Columns, typename Weight>
+EndingAnalysis analyze_endings(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t start, Weight weight,
+                               double tolerance = 1e-10, std::size_t max_iterations = 10000)
+{
+    if (start >= map.size()) throw std::out_of_range("analyze_endings start node out of range");
+
+    const std::size_t n = map.size();
+    auto csr = adventure_analysis_detail::build_incoming(map, weight);
+
+    EndingAnalysis res;
+
+    // expected visits: v = s + P^T v
+    std::vector<double> src(n, 0);
+    src[start] = 1;
+    bool conv_visits, conv_steps;
+    res.iterations = adventure_analysis_detail::solve(csr, src, nullptr, res.visits, tolerance, max_iterations, conv_visits);
+
+    // accumulated arrival time: u = P^T (u + v).
+    // u[j] is the expected sum, over visits to j, of the number of arcs taken to get there.
+    std::fill(src.begin(), src.end(), 0.0);
+    std::vector<double> arrival;
+    res.iterations += adventure_analysis_detail::solve(csr, src, res.visits.data(), arrival, tolerance, max_iterations, conv_steps);
+
+    res.converged = conv_visits && conv_steps;
+
+    // read off the ending distribution
+    res.end_prob.assign(n, 0);
+    res.end_steps.assign(n, 0);
+    double resolved = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        res.end_prob[i] = res.visits[i] * csr.terminal[i];
+        if (res.end_prob[i] > 0)
+        {
+            res.end_steps[i] = arrival[i] / res.visits[i];
+            res.expected_steps += res.end_prob[i] * res.end_steps[i];
+            resolved += res.end_prob[i];
+        }
+    }
+    res.unresolved = std::max(0.0, 1 - resolved);
+
+    return res;
+}
+// as analyze_endings() above, but with every arc equally likely
+template<typename NodePayload, typename ArcPayload, typename Columns>
+EndingAnalysis analyze_endings(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t start)
+{
+    return analyze_endings(map, start, UniformArcWeight());
+}
+
+#endif // ADVENTURE_ANALYSIS_H
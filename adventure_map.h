@@ -10,10 +10,23 @@
 #include <stdexcept>
 #include <limits>
 
+// the default column store for AdventureMap (no columns)
+struct NoColumns
+{
+    void push_back() {}
+    void erase(std::size_t) {}
+    void erase_marked(const std::vector<char>&) {}
+    void reserve(std::size_t) {}
+};
+
 // represents an adventure graph structure.
 // models a finite state machine envisioned as a graph where nodes (states) are situations (questions) and arcs are responses (choices).
 // the payload types are the types of the "data" fields of the Arc and Node types declared internally.
-template<typename NodePayload, typename ArcPayload>
+// hot per-node fields can be kept out of the nodes in a column store (structure of arrays) so passes over them stay cache friendly.
+// a column store holds one entry per node (by index) and must provide push_back() (append a default entry for a new node),
+// erase(index), erase_marked(marked) (remove the entries whose flag is set, keeping the rest in order) and reserve(count) -
+// the map keeps it in step with the nodes. see NoColumns for the default (empty) store.
+template<typename NodePayload, typename ArcPayload, typename Columns = NoColumns>
 struct AdventureMap
 {
 public: // -- types -- //
@@ -42,6 +55,7 @@ public: // -- types -- //
 private: // -- data -- //
 
     std::vector<Node> _nodes; // all the nodes in the graph
+    Columns _columns;         // the column store (one entry per node)
 
     std::size_t _state; // the current state
 
@@ -56,8 +70,17 @@ public: // -- accessors -- //
     std::size_t &state()       { return _state; }
     std::size_t  state() const { return _state; }
 
+    // gets the column store
+          Columns &columns()       { return _columns; }
+    const Columns &columns() const { return _columns; }
+
+    // gets the index of the node at the specified position
+    std::size_t index(const_iterator iter) const { return std::size_t(iter - _nodes.cbegin()); }
+
     // gets the number of nodes
     std::size_t size() const { return _nodes.size(); }
+    // gets the number of nodes that can be held without reallocating
+    std::size_t capacity() const { return _nodes.capacity(); }
 
     // returns the node at the specified index. no bounds checking.
           Node &operator[](std::size_t index)       { return _nodes[index]; }
@@ -80,14 +103,18 @@ public: // -- iterators -- //
 
 public: // -- add / remove -- //
 
-    // adds the specified node to the graph.
+    // reserves space for at least <count> nodes in total.
+    // WARNING: invalidates iterators (if reallocation occurs)
+    void reserve(std::size_t count) { _nodes.reserve(count); _columns.reserve(count); }
+
+    // adds the specified node to the graph (with default column values).
     // WARNING: invalidates iterators
-    void push_back(const Node &node) { _nodes.push_back(node); }
+    void push_back(const Node &node) { _nodes.push_back(node); _columns.push_back(); }
 
-    // adds the specified node to the graph.
+    // adds the specified node to the graph (with default column values).
     // WARNING: invalidates iterators
     template<typename ...Args>
-    void emplace_back(Args &&...args) { _nodes.emplace_back(std::forward<Args>(args)...); }
+    void emplace_back(Args &&...args) { _nodes.emplace_back(std::forward<Args>(args)...); _columns.push_back(); }
 
     // removes the specified nodes from the graph. any arcs that reference it are deleted as well. no bounds checking.
     // arcs in other nodes are updated to reflect the change. arcs pointing to the removed node are removed as well.
@@ -99,6 +126,7 @@ public: // -- add / remove -- //
 
         // remove the node (can't use the iterator since this version of C++ uses non-const iterators for erase)
         _nodes.erase(_nodes.begin() + difference_type(index));
+        _columns.erase(index);
 
         // for each remaining node
         for (Node &node : _nodes)
@@ -123,6 +151,52 @@ public: // -- add / remove -- //
         }
     }
 
+    // removes the nodes at the specified indices from the graph in a single pass (duplicates and invalid indices are ignored).
+    // as erase() above, arcs pointing to removed nodes are removed as well and the rest are updated to reflect the change.
+    // cost is linear in the size of the graph, regardless of the number of nodes removed.
+    // WARNING: invalidates iterators
+    void erase(std::vector<std::size_t> indices)
+    {
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        indices.erase(std::lower_bound(indices.begin(), indices.end(), _nodes.size()), indices.end());
+        if (indices.empty()) return;
+
+        std::vector<char> marked(_nodes.size(), 0);
+        for (std::size_t i : indices) marked[i] = 1;
+
+        // compact the remaining nodes (and columns)
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < _nodes.size(); ++i)
+        {
+            if (marked[i]) continue;
+            if (kept != i) _nodes[kept] = std::move(_nodes[i]);
+            ++kept;
+        }
+        _nodes.erase(_nodes.begin() + difference_type(kept), _nodes.end());
+        _columns.erase_marked(marked);
+
+        // for each remaining arc
+        for (Node &node : _nodes)
+        {
+            std::size_t arc_kept = 0;
+            for (std::size_t i = 0; i < node.arcs.size(); ++i)
+            {
+                Arc &arc = node.arcs[i];
+
+                // arcs that pointed to removed nodes are removed as well
+                if (arc.dest < marked.size() && marked[arc.dest]) continue;
+
+                // account for the removed nodes before this one
+                arc.dest -= std::size_t(std::lower_bound(indices.begin(), indices.end(), arc.dest) - indices.begin());
+
+                if (arc_kept != i) node.arcs[arc_kept] = std::move(arc);
+                ++arc_kept;
+            }
+            node.arcs.erase(node.arcs.begin() + difference_type(arc_kept), node.arcs.end());
+        }
+    }
+
 };
 
 #endif // ADVENTURE_MAP_H
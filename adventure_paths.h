@@ -0,0 +1,298 @@
+#ifndef ADVENTURE_PATHS_H
+#define ADVENTURE_PATHS_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "adventure_map.h"
+
+// shortest-path queries over an adventure map. every arc counts as a single step (one choice).
+// arcs whose dest is not a valid node (terminal arcs) are ignored.
+
+namespace adventure_paths
+{
+    // distance value used for nodes that cannot be reached
+    constexpr std::size_t Unreachable = std::numeric_limits<std::size_t>::max();
+}
+
+// performs a breadth first search from all the <sources> at once and returns the distance (in arcs) to every node.
+// nodes further than <max_depth> (or that can't be reached at all) have distance adventure_paths::Unreachable.
+// invalid sources are ignored.
+template<typename NodePayload, typename ArcPayload, typename Columns>
+std::vector<std::size_t> bfs_distances(const AdventureMap<NodePayload, ArcPayload, Columns> &map, const std::vector<std::size_t> &sources,
+                                       std::size_t max_depth = adventure_paths::Unreachable)
+{
+    std::vector<std::size_t> dist(map.size(), adventure_paths::Unreachable);
+
+    // the bfs frontier is kept as a flat array (each level is appended after the last)
+    std::vector<std::size_t> queue;
+    queue.reserve(sources.size());
+    for (std::size_t s : sources) if (s < map.size() && dist[s] == adventure_paths::Unreachable) { dist[s] = 0; queue.push_back(s); }
+
+    for (std::size_t head = 0; head < queue.size(); ++head)
+    {
+        std::size_t i = queue[head];
+        if (dist[i] >= max_depth) continue;
+
+        for (const auto &arc : map[i].arcs)
+        {
+            if (arc.dest < map.size() && dist[arc.dest] == adventure_paths::Unreachable)
+            {
+                dist[arc.dest] = dist[i] + 1;
+                queue.push_back(arc.dest);
+            }
+        }
+    }
+
+    return dist;
+}
+
+// returns all the nodes that are within <depth> choices of any of the <sources> (including the sources themselves)
+template<typename NodePayload, typename ArcPayload, typename Columns>
+std::vector<std::size_t> nodes_within(const AdventureMap<NodePayload, ArcPayload, Columns> &map, const std::vector<std::size_t> &sources,
+                                      std::size_t depth)
+{
+    auto dist = bfs_distances(map, sources, depth);
+
+    std::vector<std::size_t> res;
+    for (std::size_t i = 0; i < dist.size(); ++i) if (dist[i] != adventure_paths::Unreachable) res.push_back(i);
+    return res;
+}
+
+// performs an independent bfs from each of the <sources> and returns one distance array per source (in the same order).
+// the searches are split among <threads> worker threads (0 uses the hardware concurrency).
+// the map must not be modified while this is running.
+template<typename NodePayload, typename ArcPayload, typename Columns>
+std::vector<std::vector<std::size_t>> bfs_distances_parallel(const AdventureMap<NodePayload, ArcPayload, Columns> &map,
+                                                             const std::vector<std::size_t> &sources, unsigned threads = 0)
+{
+    std::vector<std::vector<std::size_t>> res(sources.size());
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<std::size_t>(threads, sources.size()));
+
+    // each worker takes every <threads>'th source, so no synchronization is needed beyond the join
+    auto work = [&](unsigned id)
+    {
+        for (std::size_t i = id; i < sources.size(); i += threads)
+            res[i] = bfs_distances(map, std::vector<std::size_t>(1, sources[i]));
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned id = 1; id < threads; ++id) pool.emplace_back(work, id);
+    if (threads > 0) work(0);
+    for (auto &t : pool) t.join();
+
+    return res;
+}
+
+namespace adventure_paths_detail
+{
+    // returns the reconstructed path from <from> to <to> (inclusive) using a predecessor array, or empty if <to> wasn't reached
+    inline std::vector<std::size_t> trace_path(const std::vector<std::size_t> &pred, std::size_t from, std::size_t to)
+    {
+        std::vector<std::size_t> path;
+        if (pred[to] == adventure_paths::Unreachable) return path;
+
+        for (std::size_t i = to; ; i = pred[i])
+        {
+            path.push_back(i);
+            if (i == from) break;
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+}
+
+// finds a shortest path from <from> to <to>. returns the sequence of nodes visited (inclusive), or empty if there is no path.
+// throws std::out_of_range if either node is invalid.
+template<typename NodePayload, typename ArcPayload, typename Columns>
+std::vector<std::size_t> shortest_path(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t from, std::size_t to)
+{
+    if (from >= map.size() || to >= map.size()) throw std::out_of_range("shortest_path node out of range");
+
+    std::vector<std::size_t> pred(map.size(), adventure_paths::Unreachable);
+    std::vector<std::size_t> queue(1, from);
+    pred[from] = from;
+
+    for (std::size_t head = 0; head < queue.size() && pred[to] == adventure_paths::Unreachable; ++head)
+    {
+        std::size_t i = queue[head];
+        for (const auto &arc : map[i].arcs)
+        {
+            if (arc.dest < map.size() && pred[arc.dest] == adventure_paths::Unreachable)
+            {
+                pred[arc.dest] = i;
+                queue.push_back(arc.dest);
+            }
+        }
+    }
+
+    return adventure_paths_detail::trace_path(pred, from, to);
+}
+
+// a precomputed landmark index for answering repeated shortest-path queries on the same map.
+// stores exact distances to and from a handful of landmark nodes, which give lower bounds on the distance between any two nodes.
+// these bounds guide an A* search that typically touches a small fraction of the map.
+// the index must be rebuilt whenever the arcs or node count of the map change (queries on a stale index may not be shortest).
+class PathIndex
+{
+private: // -- data -- //
+
+    std::size_t _size = 0; // the number of nodes in the map when the index was built
+
+    std::vector<std::size_t> _landmarks;         // the chosen landmark nodes
+    std::vector<std::vector<std::size_t>> _from; // _from[k][v] is the distance from landmark k to v
+    std::vector<std::vector<std::size_t>> _to;   // _to[k][v] is the distance from v to landmark k
+
+public: // -- ctor / dtor / asgn -- //
+
+    // constructs an empty index (every query falls back to a plain search)
+    PathIndex() = default;
+
+public: // -- accessors -- //
+
+    // gets the number of nodes the index was built for
+    std::size_t size() const { return _size; }
+    // returns true iff the index has been built
+    bool empty() const { return _landmarks.empty(); }
+
+    // gets the chosen landmark nodes
+    const std::vector<std::size_t> &landmarks() const { return _landmarks; }
+
+    // clears the index
+    void clear() { _size = 0; _landmarks.clear(); _from.clear(); _to.clear(); }
+
+public: // -- construction -- //
+
+    // builds the index for the given map using (at most) <count> landmarks.
+    // landmarks are picked greedily as the nodes furthest from the ones already picked, and the
+    // backward per-landmark searches are run in parallel on <threads> threads (0 uses the hardware concurrency).
+    template<typename NodePayload, typename ArcPayload, typename Columns>
+    void build(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t count = 8, unsigned threads = 0)
+    {
+        clear();
+        _size = map.size();
+        if (_size == 0) return;
+
+        // pick the landmarks (the forward searches are inherently sequential, since each depends on the last)
+        std::vector<std::size_t> reach(_size, adventure_paths::Unreachable);
+        for (std::size_t next = 0; _landmarks.size() < count; )
+        {
+            _landmarks.push_back(next);
+            _from.push_back(bfs_distances(map, std::vector<std::size_t>(1, next)));
+
+            const auto &dist = _from.back();
+            for (std::size_t i = 0; i < _size; ++i) reach[i] = std::min(reach[i], dist[i]);
+
+            // prefer nodes no landmark reaches at all, then the most distant one
+            std::size_t best = 0, best_dist = 0;
+            for (std::size_t i = 0; i < _size; ++i)
+                if (reach[i] > best_dist) { best = i; best_dist = reach[i]; }
+            if (best_dist == 0) break; // every node is a landmark
+
+            next = best;
+        }
+
+        // build the reversed map so we can search backwards from each landmark
+        AdventureMap<char, char> reversed;
+        for (std::size_t i = 0; i < _size; ++i) reversed.emplace_back();
+        for (std::size_t i = 0; i < _size; ++i)
+            for (const auto &arc : map[i].arcs)
+                if (arc.dest < _size) reversed[arc.dest].arcs.push_back({0, i});
+
+        _to = bfs_distances_parallel(reversed, _landmarks, threads);
+    }
+
+private: // -- helpers -- //
+
+    // lower bound on the distance from <v> to <t> (adventure_paths::Unreachable if <v> provably can't reach <t>)
+    std::size_t _bound(std::size_t v, std::size_t t) const
+    {
+        std::size_t h = 0;
+        for (std::size_t k = 0; k < _landmarks.size(); ++k)
+        {
+            // d(L,t) <= d(L,v) + d(v,t)
+            std::size_t lv = _from[k][v], lt = _from[k][t];
+            if (lv != adventure_paths::Unreachable)
+            {
+                if (lt == adventure_paths::Unreachable) return adventure_paths::Unreachable;
+                if (lt > lv) h = std::max(h, lt - lv);
+            }
+
+            // d(v,L) <= d(v,t) + d(t,L)
+            std::size_t vl = _to[k][v], tl = _to[k][t];
+            if (tl != adventure_paths::Unreachable)
+            {
+                if (vl == adventure_paths::Unreachable) return adventure_paths::Unreachable;
+                if (vl > tl) h = std::max(h, vl - tl);
+            }
+        }
+        return h;
+    }
+
+public: // -- queries -- //
+
+    // finds a shortest path from <from> to <to>, as shortest_path().
+    // if the index was built for a different number of nodes, falls back to a plain bfs.
+    template<typename NodePayload, typename ArcPayload, typename Columns>
+    std::vector<std::size_t> path(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t from, std::size_t to) const
+    {
+        if (from >= map.size() || to >= map.size()) throw std::out_of_range("PathIndex::path node out of range");
+        if (empty() || _size != map.size()) return shortest_path(map, from, to);
+
+        if (_bound(from, to) == adventure_paths::Unreachable) return {};
+
+        // A* over unit weight arcs - entries are (estimated total, node)
+        typedef std::pair<std::size_t, std::size_t> entry_t;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+
+        std::vector<std::size_t> g(_size, adventure_paths::Unreachable), pred(_size, adventure_paths::Unreachable);
+        std::vector<bool> closed(_size, false);
+        g[from] = 0;
+        pred[from] = from;
+        open.push({_bound(from, to), from});
+
+        while (!open.empty())
+        {
+            entry_t top = open.top();
+            open.pop();
+
+            std::size_t i = top.second;
+            if (i == to) break;
+            if (closed[i]) continue; // stale entry (the bounds are consistent, so the first pop is final)
+            closed[i] = true;
+
+            for (const auto &arc : map[i].arcs)
+            {
+                std::size_t j = arc.dest;
+                if (j >= _size || g[i] + 1 >= g[j]) continue;
+
+                std::size_t h = _bound(j, to);
+                if (h == adventure_paths::Unreachable) continue;
+
+                g[j] = g[i] + 1;
+                pred[j] = i;
+                open.push({g[j] + h, j});
+            }
+        }
+
+        return adventure_paths_detail::trace_path(pred, from, to);
+    }
+
+    // gets the distance from <from> to <to> (adventure_paths::Unreachable if there's no path)
+    template<typename NodePayload, typename ArcPayload, typename Columns>
+    std::size_t distance(const AdventureMap<NodePayload, ArcPayload, Columns> &map, std::size_t from, std::size_t to) const
+    {
+        auto p = path(map, from, to);
+        return p.empty() ? adventure_paths::Unreachable : p.size() - 1;
+    }
+};
+
+#endif // ADVENTURE_PATHS_H
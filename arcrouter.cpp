@@ -0,0 +1,387 @@
+#include <QMetaObject>
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <iterator>
+
+#include "arcrouter.h"
+
+// -- settings -- //
+
+constexpr qreal BundleCellSize = 400;   // the size of the cells arcs are bundled through (map units)
+constexpr qreal BundleStrength = 0.6;   // how far curves are pulled toward the bundle cell centers (0 = straight, 1 = all the way)
+constexpr qreal ObstacleCellSize = 100; // the size of the cells nodes are indexed by for collision checks (map units)
+constexpr qreal RouteClearance = 8;     // the gap to keep between a curve and the nodes it passes
+constexpr int   MinRouteSamples = 8;    // the fewest points a curve is checked at
+constexpr int   MaxRouteSamples = 64;   // the most points a curve is checked at
+constexpr int   RouteAttempts = 6;      // the most times a blocked curve is bent before settling for the best so far
+
+// returns the key of the cell at the given cell coordinates
+static std::uint64_t cellKey(std::int64_t x, std::int64_t y)
+{
+    return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+}
+// returns the cell coordinates of a point in a grid of the given cell size
+static std::int64_t cellCoord(qreal v, qreal size)
+{
+    return std::int64_t(std::floor(v / size));
+}
+
+// evaluates a cubic bezier curve at <t>
+static QPointF cubic(const QPointF (&curve)[4], qreal t)
+{
+    qreal u = 1 - t;
+    return curve[0] * (u * u * u) + curve[1] * (3 * u * u * t) + curve[2] * (3 * u * t * t) + curve[3] * (t * t * t);
+}
+
+// returns <v> scaled to unit length, or <fallback> if it's too short to have a direction
+static QPointF unit(QPointF v, QPointF fallback)
+{
+    qreal mag = std::sqrt(v.x() * v.x() + v.y() * v.y());
+    return mag < 1e-6 ? fallback : v / mag;
+}
+
+// ------------ //
+
+// -- routes -- //
+
+// ------------ //
+
+const ArcRouter::Route *ArcRouter::Table::find(std::size_t from, std::size_t arc, QPointF start, QPointF stop) const
+{
+    if (from + 1 >= first.size() || arc >= first[from + 1] - first[from]) return nullptr;
+
+    const Route &res = routes[first[from] + arc];
+    if (res.path.isEmpty() || res.start != start || res.stop != stop) return nullptr;
+    return &res;
+}
+
+QPainterPath ArcRouter::Route::copyPath() const
+{
+    QPainterPath res(curve[0]);
+    res.cubicTo(curve[1], curve[2], curve[3]);
+    return res;
+}
+
+std::size_t ArcRouter::EndpointHash::operator()(const std::pair<QPointF, QPointF> &ends) const
+{
+    std::hash<qreal> h;
+    std::size_t res = h(ends.first.x());
+    res = res * 31 + h(ends.first.y());
+    res = res * 31 + h(ends.second.x());
+    res = res * 31 + h(ends.second.y());
+    return res;
+}
+
+// ----------------- //
+
+// -- ctor / dtor -- //
+
+// ----------------- //
+
+ArcRouter::ArcRouter(qreal node_radius, qreal arrow_height, QObject *parent) :
+    QObject(parent),
+    node_radius(node_radius),
+    arrow_height(arrow_height)
+{
+    worker = std::thread(&ArcRouter::run, this);
+}
+ArcRouter::~ArcRouter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// --------------- //
+
+// -- interface -- //
+
+// --------------- //
+
+void ArcRouter::update(const StoryMap &map)
+{
+    std::unique_ptr<Snapshot> snapshot(new Snapshot);
+
+    snapshot->points.reserve(map.size());
+    for (std::size_t i = 0; i < map.size(); ++i) snapshot->points.push_back(map.columns().point(i));
+
+    snapshot->first.reserve(map.size() + 1);
+    for (const auto &node : map)
+    {
+        snapshot->first.push_back(snapshot->dests.size());
+        for (const auto &arc : node.arcs) snapshot->dests.push_back(arc.dest);
+    }
+    snapshot->first.push_back(snapshot->dests.size());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // only the latest layout matters
+        pending = std::move(snapshot);
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const ArcRouter::Table> ArcRouter::routes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return published;
+}
+
+// ------------ //
+
+// -- worker -- //
+
+// ------------ //
+
+void ArcRouter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || pending; });
+        if (stopping) return;
+
+        // take the latest snapshot and route it (without holding the lock)
+        std::unique_ptr<Snapshot> snapshot = std::move(pending);
+        lock.unlock();
+
+        std::shared_ptr<const Table> res = pass(*snapshot);
+
+        // publish the results
+        lock.lock();
+        published = std::move(res);
+        QMetaObject::invokeMethod(this, "changed", Qt::QueuedConnection);
+    }
+}
+
+std::shared_ptr<const ArcRouter::Table> ArcRouter::pass(const Snapshot &snapshot)
+{
+    // drop the routes the layout change affects, then index the new layout
+    invalidate(snapshot.points);
+    points = snapshot.points;
+
+    obstacles.clear();
+    for (std::size_t i = 0; i < points.size(); ++i)
+        obstacles[cellKey(cellCoord(points[i].x(), ObstacleCellSize), cellCoord(points[i].y(), ObstacleCellSize))].push_back(i);
+
+    for (auto &c : cache) c.used = false;
+
+    std::shared_ptr<Table> res = std::make_shared<Table>();
+    res->first = snapshot.first;
+    res->routes.resize(snapshot.dests.size());
+
+    // route each arc between two nodes (terminal arcs are left empty), taking whatever is still cached
+    for (std::size_t i = 0; i + 1 < snapshot.first.size(); ++i)
+    {
+        for (std::size_t a = snapshot.first[i]; a < snapshot.first[i + 1]; ++a)
+        {
+            const std::size_t dest = snapshot.dests[a];
+            if (dest >= points.size()) continue;
+
+            const auto ends = std::make_pair(points[i], points[dest]);
+            std::size_t slot;
+
+            auto found = by_ends.find(ends);
+            if (found != by_ends.end()) slot = found->second;
+            else
+            {
+                if (free_slots.empty()) { slot = cache.size(); cache.emplace_back(); }
+                else { slot = free_slots.back(); free_slots.pop_back(); }
+
+                cache[slot] = route(ends.first, ends.second, i, dest);
+                cache[slot].live = true;
+                by_ends.emplace(ends, slot);
+                for (std::uint64_t cell : cache[slot].cells) by_cell[cell].push_back(slot);
+            }
+
+            cache[slot].used = true;
+            res->routes[a] = cache[slot].route;
+        }
+    }
+
+    // forget the routes no arc uses any more
+    for (std::size_t slot = 0; slot < cache.size(); ++slot)
+        if (cache[slot].live && !cache[slot].used) evict(slot);
+
+    return res;
+}
+
+void ArcRouter::invalidate(const std::vector<QPointF> &next)
+{
+    // find the positions that have been vacated or newly occupied
+    std::vector<QPointF> changed;
+    if (next.size() == points.size())
+    {
+        // the usual case (nodes moved or edited in place) - compare node by node
+        for (std::size_t i = 0; i < next.size(); ++i)
+        {
+            if (next[i] == points[i]) continue;
+            changed.push_back(points[i]);
+            changed.push_back(next[i]);
+        }
+    }
+    else
+    {
+        // nodes were added or removed (shifting the indices) - compare the positions as sets
+        auto less = [](QPointF a, QPointF b) { return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y()); };
+        std::vector<QPointF> before = points, after = next;
+        std::sort(before.begin(), before.end(), less);
+        std::sort(after.begin(), after.end(), less);
+        std::set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(changed), less);
+    }
+
+    // drop every route that passes near any of them
+    const std::int64_t span = std::int64_t(std::ceil((node_radius + RouteClearance) / ObstacleCellSize));
+    for (QPointF p : changed)
+    {
+        const std::int64_t cx = cellCoord(p.x(), ObstacleCellSize), cy = cellCoord(p.y(), ObstacleCellSize);
+        for (std::int64_t x = cx - span; x <= cx + span; ++x)
+        {
+            for (std::int64_t y = cy - span; y <= cy + span; ++y)
+            {
+                auto i = by_cell.find(cellKey(x, y));
+                if (i == by_cell.end()) continue;
+
+                // evicting edits the list, so work from a copy
+                std::vector<std::size_t> slots = i->second;
+                for (std::size_t slot : slots) evict(slot);
+            }
+        }
+    }
+}
+
+void ArcRouter::evict(std::size_t slot)
+{
+    Cached &c = cache[slot];
+    if (!c.live) return;
+
+    auto i = by_ends.find(std::make_pair(c.route.start, c.route.stop));
+    if (i != by_ends.end() && i->second == slot) by_ends.erase(i);
+
+    for (std::uint64_t cell : c.cells)
+    {
+        auto j = by_cell.find(cell);
+        if (j == by_cell.end()) continue;
+
+        auto &slots = j->second;
+        slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+        if (slots.empty()) by_cell.erase(j);
+    }
+
+    c = Cached();
+    free_slots.push_back(slot);
+}
+
+// ------------- //
+
+// -- routing -- //
+
+// ------------- //
+
+ArcRouter::Cached ArcRouter::route(QPointF start, QPointF stop, std::size_t from, std::size_t dest) const
+{
+    Cached res;
+    res.route.start = start;
+    res.route.stop = stop;
+
+    // too short to draw anything between the nodes (as for straight arcs)
+    const QPointF d = stop - start;
+    const qreal len = std::sqrt(d.x() * d.x() + d.y() * d.y());
+    if (len < 2 * node_radius) return res;
+    const QPointF along = d / len, normal(-along.y(), along.x());
+
+    // pull the control points toward the centers of the bundle cells at each end, so arcs between the same cells converge
+    QPointF a = start + d / 3, b = start + d * 2 / 3;
+    const std::int64_t sx = cellCoord(start.x(), BundleCellSize), sy = cellCoord(start.y(), BundleCellSize);
+    const std::int64_t tx = cellCoord(stop.x(), BundleCellSize), ty = cellCoord(stop.y(), BundleCellSize);
+    if (sx != tx || sy != ty)
+    {
+        a += (QPointF((sx + 0.5) * BundleCellSize, (sy + 0.5) * BundleCellSize) - a) * BundleStrength;
+        b += (QPointF((tx + 0.5) * BundleCellSize, (ty + 0.5) * BundleCellSize) - b) * BundleStrength;
+    }
+
+    // bend the curve around any nodes in the way, alternating sides with growing offsets
+    QPointF curve[4] = { start, a, b, stop }, best[4] = { start, a, b, stop };
+    QPointF hit;
+    std::size_t best_blocked = blocked(curve, from, dest, hit, nullptr);
+    qreal away = QPointF::dotProduct(hit - start, normal) > 0 ? -1 : 1;
+    for (int attempt = 1; best_blocked != 0 && attempt <= RouteAttempts; ++attempt)
+    {
+        const qreal side = attempt % 2 ? away : -away;
+        const qreal offset = side * 2 * (node_radius + RouteClearance) * ((attempt + 1) / 2);
+        curve[1] = a + normal * offset;
+        curve[2] = b + normal * offset;
+
+        std::size_t count = blocked(curve, from, dest, hit, nullptr);
+        if (count < best_blocked)
+        {
+            best_blocked = count;
+            std::copy(curve, curve + 4, best);
+        }
+    }
+    blocked(best, from, dest, hit, &res.cells);
+
+    // trim the ends to the node edges (leaving room for the arrow head)
+    const QPointF dir0 = unit(best[1] - best[0], along), dir1 = unit(best[3] - best[2], along);
+    res.route.tip = stop - dir1 * node_radius;
+    res.route.dir = dir1;
+    res.route.curve[0] = start + dir0 * node_radius;
+    res.route.curve[1] = best[1];
+    res.route.curve[2] = best[2];
+    res.route.curve[3] = res.route.tip - dir1 * arrow_height;
+    res.route.path = res.route.copyPath();
+
+    return res;
+}
+
+std::size_t ArcRouter::blocked(const QPointF (&curve)[4], std::size_t from, std::size_t dest, QPointF &hit, std::vector<std::uint64_t> *cells) const
+{
+    const qreal reach = node_radius + RouteClearance;
+    const std::int64_t span = std::int64_t(std::ceil(reach / ObstacleCellSize));
+
+    // check points no further apart than a node is wide, so none can slip between them
+    const QPointF d = curve[3] - curve[0];
+    const qreal len = std::sqrt(d.x() * d.x() + d.y() * d.y());
+    const int samples = std::max(MinRouteSamples, std::min(MaxRouteSamples, int(std::ceil(len / reach))));
+
+    std::size_t res = 0;
+    for (int s = 1; s < samples; ++s)
+    {
+        const QPointF p = cubic(curve, qreal(s) / samples);
+        const std::int64_t cx = cellCoord(p.x(), ObstacleCellSize), cy = cellCoord(p.y(), ObstacleCellSize);
+        if (cells) cells->push_back(cellKey(cx, cy));
+
+        bool found = false;
+        for (std::int64_t x = cx - span; x <= cx + span && !found; ++x)
+        {
+            for (std::int64_t y = cy - span; y <= cy + span && !found; ++y)
+            {
+                auto i = obstacles.find(cellKey(x, y));
+                if (i == obstacles.end()) continue;
+
+                for (std::size_t n : i->second)
+                {
+                    if (n == from || n == dest) continue;
+
+                    const QPointF v = points[n] - p;
+                    if (v.x() * v.x() + v.y() * v.y() < reach * reach) { hit = points[n]; found = true; break; }
+                }
+            }
+        }
+        if (found) ++res;
+    }
+
+    if (cells)
+    {
+        std::sort(cells->begin(), cells->end());
+        cells->erase(std::unique(cells->begin(), cells->end()), cells->end());
+    }
+    return res;
+}
@@ -0,0 +1,145 @@
+#ifndef ARCROUTER_H
+#define ARCROUTER_H
+
+#include <QObject>
+#include <QPointF>
+#include <QPainterPath>
+
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+#include "story.h"
+
+// routes the arcs of a story as curves on a worker thread, for drawing dense maps legibly.
+// arcs are bundled: each curve is pulled toward the centers of the coarse cells its ends lie in, so arcs between the same
+// regions of the map converge into shared paths instead of fanning out as separate straight lines. curves that would pass
+// through a node are bent around it.
+// a route only depends on its endpoints and the nodes near its path, so routes are cached by endpoint position. each pass
+// reroutes just the arcs whose endpoints moved, or whose cached path ran near a node that moved (or was added/removed).
+class ArcRouter : public QObject
+{
+    Q_OBJECT
+
+public: // -- types -- //
+
+    // the routed curve of an arc
+    struct Route
+    {
+        QPointF start, stop; // the node positions it was routed between
+        QPointF curve[4];    // the cubic bezier from the edge of the start node to the base of the arrow head
+        QPainterPath path;   // <curve> as a path (empty if the arc isn't routed)
+        QPointF tip;         // where the arrow head points to (the edge of the stop node)
+        QPointF dir;         // the direction the curve arrives in (unit length)
+
+        // builds a private copy of <path> from <curve>.
+        // painting a path caches data inside it, so a path shared between threads (as <path> is, through the published
+        // tables) must only be drawn on the owning thread - other threads draw copies.
+        QPainterPath copyPath() const;
+    };
+
+    // the routes of every arc in a map, in node/arc order
+    struct Table
+    {
+        std::vector<std::size_t> first; // the routes of node i are [first[i], first[i + 1])
+        std::vector<Route> routes;
+
+        // returns the route of arc <arc> of node <from> if it's still current - null if the node's arcs or the positions
+        // of its ends (<start>/<stop>) have changed since it was routed (the arc is best drawn straight until it's rerouted)
+        const Route *find(std::size_t from, std::size_t arc, QPointF start, QPointF stop) const;
+    };
+
+private: // -- types -- //
+
+    // the layout of the map as of an update() (what the worker routes)
+    struct Snapshot
+    {
+        std::vector<QPointF> points;        // the position of each node
+        std::vector<std::size_t> first;     // the arcs of node i are [first[i], first[i + 1])
+        std::vector<std::size_t> dests;     // the dest of each arc
+    };
+
+    // a cached route, with the obstacle cells its path passes through
+    struct Cached
+    {
+        Route route;
+        std::vector<std::uint64_t> cells;
+        bool live = false; // false once evicted (the slot is reused)
+        bool used = false; // used by the current pass
+    };
+
+    // hashes a pair of endpoints
+    struct EndpointHash
+    {
+        std::size_t operator()(const std::pair<QPointF, QPointF> &ends) const;
+    };
+
+private: // -- data -- //
+
+    const qreal node_radius;  // the radius of a node
+    const qreal arrow_height; // how far the arrow head reaches back from the tip (the path stops short by this much)
+
+    mutable std::mutex mutex;           // guards everything shared with the worker (below)
+    std::condition_variable wake;       // signals the worker that there's a new snapshot (or it should stop)
+    std::unique_ptr<Snapshot> pending;  // the latest snapshot not yet routed (older ones are dropped)
+    bool stopping = false;              // tells the worker to finish
+    std::shared_ptr<const Table> published; // the latest routes
+
+    std::thread worker;
+
+    // worker state (only touched by the worker thread)
+    std::vector<QPointF> points;                              // the node positions of the last pass
+    std::vector<Cached> cache;                                // the cached routes (by slot)
+    std::vector<std::size_t> free_slots;                      // evicted slots in <cache>
+    std::unordered_map<std::pair<QPointF, QPointF>, std::size_t, EndpointHash> by_ends; // endpoints -> slot
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> by_cell;                // obstacle cell -> slots passing through
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> obstacles;              // obstacle cell -> nodes in it
+
+public: // -- ctor / dtor / asgn -- //
+
+    // starts the worker. <node_radius> and <arrow_height> give the size of what's drawn at the ends of each route.
+    ArcRouter(qreal node_radius, qreal arrow_height, QObject *parent = nullptr);
+    // stops the worker (discarding any pending snapshot)
+    virtual ~ArcRouter() override;
+
+public: // -- interface -- //
+
+    // queues a routing pass over the map's current layout (call from the owning thread after nodes move or arcs change).
+    // this only copies the positions and arc dests, so it never waits on the worker.
+    void update(const StoryMap &map);
+
+    // returns the latest published routes (null before the first pass finishes). safe to call from any thread.
+    std::shared_ptr<const Table> routes() const;
+
+signals:
+
+    // emitted (on the owning thread) when new routes have been published
+    void changed();
+
+private: // -- helpers -- //
+
+    // the worker loop
+    void run();
+
+    // routes a snapshot, reusing whatever is still valid from the last pass
+    std::shared_ptr<const Table> pass(const Snapshot &snapshot);
+
+    // drops the cached routes passing near any node whose position changed since the last pass
+    void invalidate(const std::vector<QPointF> &next);
+    // removes a cached route
+    void evict(std::size_t slot);
+
+    // routes a single arc between two nodes (neither of which counts as an obstacle)
+    Cached route(QPointF start, QPointF stop, std::size_t from, std::size_t dest) const;
+    // returns how many of the points the curve is checked at fall within a node (other than <from> and <dest>), setting <hit>
+    // to the last such node's position. notes the obstacle cells the checked points fall in into <cells> (if non-null).
+    std::size_t blocked(const QPointF (&curve)[4], std::size_t from, std::size_t dest, QPointF &hit, std::vector<std::uint64_t> *cells) const;
+};
+
+#endif // ARCROUTER_H
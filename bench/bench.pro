@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Benchmarks for the core editor operations.
+# Build with qmake from this directory and run uchoose_bench [node counts...]
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = uchoose_bench
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+profiling: DEFINES += UCHOOSE_PROFILING
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        main.cpp \
+        ../mainwindow.cpp \
+    ../nodeeditor.cpp \
+    ../searchindex.cpp \
+    ../storyio.cpp \
+    ../story_generator.cpp \
+    ../profiler.cpp \
+    ../story_script.cpp \
+    ../storytextpager.cpp \
+    ../minimap.cpp \
+    ../story.cpp \
+    ../storyvalidator.cpp \
+    ../storydiff.cpp \
+    ../arcrouter.cpp
+
+HEADERS += \
+        ../mainwindow.h \
+    ../nodeeditor.h \
+    ../minimap.h \
+    ../storyvalidator.h \
+    ../arcrouter.h
+
+FORMS += \
+        ../mainwindow.ui \
+    ../nodeeditor.ui
@@ -0,0 +1,153 @@
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QMouseEvent>
+#include <QImage>
+
+#include <vector>
+#include <cstdio>
+
+#include "mainwindow.h"
+#include "story_generator.h"
+#include "storyio.h"
+
+// benchmarks the core editor operations on synthetic maps of various sizes.
+// results are written to stdout as one json object per line:
+//     {"op": <name>, "nodes": <map size>, "reps": <repetitions>, "ns_per_op": <mean time>}
+
+// -------------- //
+
+// -- settings -- //
+
+// -------------- //
+
+constexpr qint64 MinBenchTime = 200000000; // the minimum total time to spend on each measurement (nanoseconds)
+constexpr int    MaxBenchReps = 1000;      // the maximum number of repetitions of each measurement
+
+constexpr std::size_t EraseCount = 10; // the number of nodes erased by the erase benchmark
+
+const QSize WindowSize(1280, 720); // the size of the editor window used for hit-test/select/paint
+
+// ------------- //
+
+// -- helpers -- //
+
+// ------------- //
+
+// prints a result line
+static void report(const char *op, std::size_t nodes, int reps, double ns_per_op)
+{
+    std::printf("{\"op\": \"%s\", \"nodes\": %zu, \"reps\": %d, \"ns_per_op\": %.1f}\n", op, nodes, reps, ns_per_op);
+    std::fflush(stdout);
+}
+
+// repeatedly runs <f> until enough time has passed and reports the mean time per call
+template<typename F>
+static void bench(const char *op, std::size_t nodes, F f)
+{
+    QElapsedTimer timer;
+    int reps = 0;
+
+    timer.start();
+    do { f(); ++reps; } while (timer.nsecsElapsed() < MinBenchTime && reps < MaxBenchReps);
+
+    report(op, nodes, reps, double(timer.nsecsElapsed()) / reps);
+}
+// runs <f> exactly once and reports the time taken (for operations that consume their input)
+template<typename F>
+static void benchOnce(const char *op, std::size_t nodes, F f)
+{
+    QElapsedTimer timer;
+    timer.start();
+    f();
+    report(op, nodes, 1, double(timer.nsecsElapsed()));
+}
+
+// sends a mouse event to the widget
+static void sendMouse(QWidget &w, QEvent::Type type, QPointF pos, Qt::MouseButton button)
+{
+    QMouseEvent e(type, pos, button, type == QEvent::MouseButtonRelease ? Qt::NoButton : button, Qt::NoModifier);
+    QCoreApplication::sendEvent(&w, &e);
+}
+
+// ---------- //
+
+// -- main -- //
+
+// ---------- //
+
+static void benchSize(std::size_t nodes, const QString &dir)
+{
+    StoryGeneratorParams params;
+    params.nodes = nodes;
+
+    StoryMap map;
+    benchOnce("generate", nodes, [&]() { map = generateStory(params); });
+
+    // -- map operations -- //
+
+    benchOnce("insert", nodes, [&]()
+    {
+        StoryMap copy;
+        for (std::size_t i = 0; i < map.size(); ++i)
+        {
+            copy.push_back(map[i]);
+            copy.columns().point(i, map.columns().point(i));
+        }
+    });
+
+    {
+        StoryMap copy = map;
+        QElapsedTimer timer;
+        timer.start();
+        for (std::size_t i = 0; i < EraseCount && copy.size() > 0; ++i) copy.erase(copy.cbegin() + StoryMap::difference_type(copy.size() / 2));
+        report("erase", nodes, int(EraseCount), double(timer.nsecsElapsed()) / EraseCount);
+    }
+
+    const QString path = dir + QString("/bench_%1.uchoose").arg(nodes);
+    benchOnce("save", nodes, [&]() { saveStory(map, path); });
+    benchOnce("load", nodes, [&]() { StoryMap loaded; loadStory(loaded, path); });
+
+    // -- editor operations -- //
+
+    MainWindow w;
+    w.resize(WindowSize);
+    w.openFile(path);
+
+    // hit-test the last node (worst case for a linear scan)
+    const QPointF last = map.columns().point(map.size() - 1);
+    bench("hit_test", nodes, [&]()
+    {
+        sendMouse(w, QEvent::MouseButtonPress, last, Qt::RightButton);
+        sendMouse(w, QEvent::MouseButtonRelease, last, Qt::RightButton);
+    });
+
+    // box-select the whole window (starting between nodes so it isn't a drag)
+    const QPointF between(params.spacing / 2, params.spacing / 2);
+    bench("box_select", nodes, [&]()
+    {
+        sendMouse(w, QEvent::MouseButtonPress, between, Qt::LeftButton);
+        sendMouse(w, QEvent::MouseButtonRelease, QPointF(WindowSize.width(), WindowSize.height()), Qt::LeftButton);
+    });
+
+    // full repaint into an offscreen image
+    QImage image(WindowSize, QImage::Format_ARGB32_Premultiplied);
+    bench("repaint", nodes, [&]() { w.render(&image); });
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    // node counts can be given on the command line
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(std::size_t(QString(argv[i]).toULongLong()));
+    if (sizes.empty()) sizes = {1000, 100000, 1000000};
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) { std::fprintf(stderr, "failed to create temporary directory\n"); return 1; }
+
+    for (std::size_t nodes : sizes) if (nodes > 0) benchSize(nodes, dir.path());
+
+    return 0;
+}
@@ -5,14 +5,35 @@
 #include <QMenu>
 #include <QAction>
 #include <QActionGroup>
+#include <QMessageBox>
+#include <QFontMetrics>
+#include <QInputDialog>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QDockWidget>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QApplication>
+#include <QClipboard>
+#include <QMimeData>
+#include <QStringList>
 
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
 #include "nodeeditor.h"
+#include "adventure_analysis.h"
+#include "storyio.h"
+#include "storydiff.h"
+#include "storytextpager.h"
+#include "story_generator.h"
+#include "profiler.h"
 
 // -------------- //
 
@@ -28,9 +49,32 @@ constexpr qreal ArrowRecess = 5;  // the recess amount for the very tip of the a
 
 constexpr qreal SelectHaloRadius = 30; // the radius for a selection halo
 
+constexpr qint64      LazyTextThreshold = 256 * 1024 * 1024; // story files at least this big (bytes) leave node text on disk
+constexpr std::size_t TextCacheBudget = 64 * 1024 * 1024;    // the memory budget for paged-in node text (bytes)
+
+constexpr std::size_t PathLandmarks = 8; // the number of landmarks to use for the shortest path index
+constexpr int         PathDelay = 150;    // how long edits must be quiet before the highlighted path is updated (milliseconds)
+
+constexpr qreal CullTextMargin = 400; // how far node text is assumed to reach when culling nodes outside the painted area
+constexpr qreal RoutedArcMargin = 300; // how far a routed arc is assumed to stray from the line between its ends when culling
+
+constexpr int    ExportTileSize = 2048;                 // the size of an export tile (pixels)
+constexpr qint64 ExportMaxStitchPixels = 8192LL * 8192; // exported images bigger than this are written as separate tiles
+constexpr qreal  ExportMargin = 50;                     // the margin around the map in exports (map units)
+
+constexpr int MaxDiagnosticsListed = 1000; // the most diagnostics to show in the panel at once
+
+constexpr int ReloadDelay = 250; // how long the story file must be quiet before it's reloaded (milliseconds)
+
+constexpr qreal DuplicateOffset = 60; // how far duplicated nodes are placed from the originals (map units)
+
 constexpr int DragSleepTime = 16;   // the frequency of drag   action frame updates (milliseconds)
 constexpr int SelectSleepTime = 16; // the frequency of select action frame updates (milliseconds)
 
+const QString StoryFileFilter("UChoose Stories (*.uchoose);;All Files (*)"); // file dialog filter for story files
+
+const QColor ExportBackground(Qt::white);
+
 const QBrush NodeBrush(Qt::NoBrush);
 const QPen   NodePen(QBrush(Qt::black), 3);
 
@@ -40,9 +84,57 @@ const QPen   ArcPen(ArcBrush, 3, Qt::SolidLine, Qt::FlatCap, Qt::PenJoinStyle::M
 const QBrush SelectedNodeBrush(Qt::NoBrush);
 const QPen   SelectedNodePen(QBrush(0xefb12b), 3, Qt::DashDotLine);
 
+const QBrush GroupNodeBrush(Qt::NoBrush);
+const QPen   GroupNodePen(QBrush(0x6a4fb0), 3);
+
+constexpr qreal GroupRingInset = 5; // the gap between the two rings drawn for a collapsed group
+
+const QBrush HighlightArcBrush(0x2b8fef);
+const QPen   HighlightArcPen(HighlightArcBrush, 5, Qt::SolidLine, Qt::FlatCap, Qt::PenJoinStyle::MiterJoin);
+
+constexpr qreal OverlayMargin = 8; // the margin around the profiling overlay text
+
+const QColor OverlayBackground(255, 255, 255, 200);
+const QPen   OverlayTextPen(Qt::black);
+
 const QBrush SelectionRectBrush(Qt::NoBrush);
 const QPen   SelectionRectPen(QBrush(0xefb12b), 3, Qt::DashDotLine);
 
+// -- geometry -- //
+
+// computes the arrow head for an arc arriving at <tip> in the (unit) direction <dir>
+static void arrowHead(QPointF tip, QPointF dir, QPointF (&head)[3])
+{
+    QPointF right(-dir.y(), dir.x()); // create a vector pointing to the right of dir
+
+    head[0] = tip - dir * ArrowRecess;
+    head[1] = tip - dir * ArrowHeight + right * ArrowWidth;
+    head[2] = tip - dir * ArrowHeight - right * ArrowWidth;
+}
+
+// computes the line and arrow head for an arc between two node positions.
+// returns false if the nodes are too close together for the arc to be visible.
+static bool arrowGeometry(QPointF start, QPointF stop, QPointF &line_start, QPointF &line_stop, QPointF (&head)[3])
+{
+    QPointF dir = stop - start;
+    qreal mag = std::sqrt(dir.x() * dir.x() + dir.y() * dir.y());
+
+    // if mag is such that the resulting line will be visible
+    if (mag < 2 * NodeRadius) return false;
+
+    dir /= mag; // normalize dir
+
+    // correct the start/stop points
+    start += dir * NodeRadius;
+    stop -= dir * NodeRadius;
+
+    line_start = start;
+    line_stop = stop - dir * ArrowHeight;
+
+    arrowHead(stop, dir, head);
+    return true;
+}
+
 // ----------------- //
 
 // -- ctor / dtor -- //
@@ -51,7 +143,9 @@ const QPen   SelectionRectPen(QBrush(0xefb12b), 3, Qt::DashDotLine);
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    text_pager(TextCacheBudget),
+    router(NodeRadius, ArrowHeight)
 {
     // -- set up auto-generated ui -- //
 
@@ -63,25 +157,110 @@ MainWindow::MainWindow(QWidget *parent) :
 
     background_context->addAction("Add Node", this, SLOT(background_context_add_node()));
 
+    // -- build the minimap panel -- //
+
+    minimap = new Minimap(map.columns(), this);
+    QDockWidget *minimap_dock = new QDockWidget("Minimap", this);
+    minimap_dock->setWidget(minimap);
+    addDockWidget(Qt::RightDockWidgetArea, minimap_dock);
+    connect(minimap, &Minimap::panRequested, this, &MainWindow::centerOn);
+
+    // -- build the diagnostics panel -- //
+
+    diagnostics_list = new QListWidget(this);
+    diagnostics_dock = new QDockWidget("Diagnostics", this);
+    diagnostics_dock->setWidget(diagnostics_list);
+    addDockWidget(Qt::BottomDockWidgetArea, diagnostics_dock);
+    connect(&validator, SIGNAL(changed()), this, SLOT(diagnostics_changed()));
+    connect(diagnostics_list, SIGNAL(itemActivated(QListWidgetItem*)), this, SLOT(diagnostics_activated(QListWidgetItem*)));
+
+    // -- set up reloading -- //
+
+    file_watcher = new QFileSystemWatcher(this);
+    reload_timer = new QTimer(this);
+    reload_timer->setSingleShot(true);
+    reload_timer->setInterval(ReloadDelay);
+    connect(file_watcher, SIGNAL(fileChanged(QString)), reload_timer, SLOT(start()));
+    connect(reload_timer, SIGNAL(timeout()), this, SLOT(file_changed()));
+
+    // -- build the file menu -- //
+
+    ui->menuFile->addAction("Open...", this, SLOT(file_open()), QKeySequence::Open);
+    ui->menuFile->addAction("Save", this, SLOT(file_save()), QKeySequence::Save);
+    ui->menuFile->addAction("Save As...", this, SLOT(file_save_as()), QKeySequence::SaveAs);
+    QAction *reload = ui->menuFile->addAction("Reload When Changed", this, SLOT(file_toggle_reload()));
+    reload->setCheckable(true);
+    ui->menuFile->addSeparator();
+    ui->menuFile->addAction("Export Image...", this, SLOT(file_export_image()));
+    ui->menuFile->addAction("Export SVG...", this, SLOT(file_export_svg()));
+
+    // -- build the edit menu -- //
+
+    ui->menuEdit->addAction("Find...", this, SLOT(edit_find()), QKeySequence::Find);
+    ui->menuEdit->addSeparator();
+    ui->menuEdit->addAction("Cut", this, SLOT(edit_cut()), QKeySequence::Cut);
+    ui->menuEdit->addAction("Copy", this, SLOT(edit_copy()), QKeySequence::Copy);
+    ui->menuEdit->addAction("Paste", this, SLOT(edit_paste()), QKeySequence::Paste);
+    ui->menuEdit->addAction("Paste Without Outside Arcs", this, SLOT(edit_paste_internal()), QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_V));
+    ui->menuEdit->addAction("Duplicate", this, SLOT(edit_duplicate()), QKeySequence(Qt::CTRL + Qt::Key_D));
+    ui->menuEdit->addAction("Delete", this, SLOT(edit_delete()), QKeySequence::Delete);
+    ui->menuEdit->addSeparator();
+    ui->menuEdit->addAction("Group Selection...", this, SLOT(edit_group_selection()), QKeySequence(Qt::CTRL + Qt::Key_G));
+    ui->menuEdit->addAction("Ungroup Selection", this, SLOT(edit_ungroup_selection()), QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_G));
+    ui->menuEdit->addAction("Collapse Selected Groups", this, SLOT(edit_collapse_groups()));
+    ui->menuEdit->addAction("Expand All Groups", this, SLOT(edit_expand_groups()));
+
+    // -- set up path highlighting -- //
+
+    path_timer = new QTimer(this);
+    path_timer->setSingleShot(true);
+    path_timer->setInterval(PathDelay);
+    connect(path_timer, SIGNAL(timeout()), this, SLOT(path_changed()));
+
+    // -- build the tools menu -- //
+
+    ui->menuTools->addAction("Analyze Endings", this, SLOT(tools_analyze_endings()));
+    ui->menuTools->addAction("Select Within N Choices...", this, SLOT(tools_select_within()));
+    ui->menuTools->addSeparator();
+    ui->menuTools->addAction("Generate Synthetic Story...", this, SLOT(tools_generate_story()));
+    ui->menuTools->addSeparator();
+    ui->menuTools->addAction(minimap_dock->toggleViewAction());
+    ui->menuTools->addAction(diagnostics_dock->toggleViewAction());
+    QAction *routing = ui->menuTools->addAction("Route Arcs", this, SLOT(tools_toggle_arc_routing()));
+    routing->setCheckable(true);
+    connect(&router, SIGNAL(changed()), this, SLOT(update()));
+
+#ifdef UCHOOSE_PROFILING
+    ui->menuTools->addSeparator();
+    QAction *overlay = ui->menuTools->addAction("Performance Overlay", this, SLOT(tools_toggle_profile_overlay()), QKeySequence(Qt::Key_F3));
+    overlay->setCheckable(true);
+    ui->menuTools->addAction("Export Performance Trace...", this, SLOT(tools_export_trace()));
+#endif
+
     // !! TEMP STUFF !! //
 
     decltype(map)::Node node;
     decltype(map)::Arc arc;
 
+    node.data.uid = 1;
     node.data.title = "first";
     node.data.text = "hello this is bob";
-    node.data.point = QPoint(50, 50);
 
     arc.dest = 1; // arc from 0 -> 1
     arc.data.text = "choice 1";
     node.arcs.push_back(arc);
     map.push_back(node);
+    map.columns().point(0, QPoint(50, 50));
 
+    node.data.uid = 2;
     node.data.title = "second";
     node.data.text = "hello this is fred";
-    node.data.point = QPoint(200, 80);
     node.arcs.clear();
     map.push_back(node);
+    map.columns().point(1, QPoint(200, 80));
+
+    minimap->rebuild();
+    validator.reset(map);
 }
 
 MainWindow::~MainWindow()
@@ -91,6 +270,425 @@ MainWindow::~MainWindow()
 
 // ------------- //
 
+// -- file io -- //
+
+// ------------- //
+
+bool MainWindow::openFile(const QString &path)
+{
+    // abandon any in-progress actions (they hold iterators)
+    _cancel_drag();
+    _cancel_select();
+
+    // large stories leave their node text on disk to be paged in as needed
+    if (QFileInfo(path).size() >= LazyTextThreshold)
+    {
+        if (!loadStoryStructure(map, path, &groups)) return false;
+        text_pager.open(path);
+    }
+    else
+    {
+        if (!loadStory(map, path, &groups)) return false;
+        text_pager.close();
+    }
+    file_path = path;
+    file_base = map;
+    watchFile();
+
+    mapReplaced();
+    return true;
+}
+bool MainWindow::saveFile(const QString &path)
+{
+    if (!saveStory(map, path, &text_pager, &groups)) return false;
+    file_path = path;
+    watchFile();
+
+    // if we're paging text, the bodies now live in the new file (at new offsets)
+    if (text_pager.isOpen())
+    {
+        Map_t saved;
+        if (!loadStoryStructure(saved, path) || saved.size() != map.size()) return false;
+
+        for (std::size_t i = 0; i < map.size(); ++i)
+        {
+            map[i].data.text.clear();
+            map[i].data.body_offset = saved[i].data.body_offset;
+            map[i].data.body_size = saved[i].data.body_size;
+        }
+        text_pager.open(path);
+    }
+    file_base = map;
+
+    return true;
+}
+
+void MainWindow::watchFile()
+{
+    if (!file_watcher->files().isEmpty()) file_watcher->removePaths(file_watcher->files());
+    if (reload_on_change && !file_path.isEmpty()) file_watcher->addPath(file_path);
+
+    // so our own writes aren't mistaken for outside changes
+    file_stamp = QFileInfo(file_path).lastModified();
+}
+
+bool MainWindow::reloadFile()
+{
+    PROFILE_SCOPE("reloadFile");
+
+    // any difference from the file as we last read/wrote it is an unsaved edit.
+    // (with paged text both sides hold the same empty text for bodies on disk, and edited text is resident.)
+    const bool edited = !diffStories(file_base, map).empty();
+
+    // paged text isn't resident to merge, so large stories are reopened - as long as that doesn't throw away edits
+    if (text_pager.isOpen())
+    {
+        if (edited && QMessageBox::question(this, "Reload Story", QFileInfo(file_path).fileName() +
+                                            " changed on disk. Reload it and discard your unsaved changes?") != QMessageBox::Yes)
+        {
+            statusBar()->showMessage(QString("Not reloaded %1: it has unsaved changes").arg(QFileInfo(file_path).fileName()));
+            return true;
+        }
+        return openFile(file_path);
+    }
+
+    Map_t updated;
+    std::vector<StoryGroup> updated_groups;
+    if (!loadStory(updated, file_path, &updated_groups)) return false;
+
+    // abandon any in-progress actions (they hold iterators)
+    _cancel_drag();
+    _cancel_select();
+
+    // merge the file's changes into the unsaved edits (if any). the merged map goes with our group table.
+    StoryMerge merge;
+    if (edited) merge = mergeStories(file_base, map, updated);
+    const Map_t &target = edited ? merge.map : updated;
+
+    const auto diff = diffStories(map, target);
+
+    // note the removed nodes and the points the minimap has to account for (the old ones are gone once the map is patched)
+    std::vector<std::size_t> removed;
+    std::vector<QPointF> vacated, arrived;
+    std::vector<std::pair<QPointF, QPointF>> moved;
+    for (const auto &d : diff)
+    {
+        if (d.changes & StoryNodeDiff::Removed) { removed.push_back(d.old_index); vacated.push_back(map.columns().point(d.old_index)); }
+        else if (d.changes & StoryNodeDiff::Added) arrived.push_back(target.columns().point(d.new_index));
+        else if (d.changes & StoryNodeDiff::Moved) moved.emplace_back(map.columns().point(d.old_index), target.columns().point(d.new_index));
+    }
+    const std::size_t erased = removed.size(), added = arrived.size();
+
+    unindexNodes(removed);
+
+    const StoryPatch patch = patchStory(map, target, diff);
+    if (!edited) groups = std::move(updated_groups);
+    file_base = std::move(updated);
+    minimap->updateNodes(vacated, moved, arrived); // (a rebuild reads the patched map)
+
+    // bring everything derived from the map up to date with just the nodes that changed
+    QStringList script_errors;
+    auto refresh = [&](std::size_t index)
+    {
+        for (auto &arc : map[index].arcs) compileArc(arc.data, symbols, &script_errors);
+        if (search_index_built) indexNode(index);
+    };
+    for (std::size_t i : patch.changed) refresh(i);
+    for (std::size_t i = patch.first_added; i < map.size(); ++i) refresh(i);
+
+    // the validator applies these in order: the erase, then the appended nodes, then the edits (which may point at them)
+    if (!patch.erased.empty()) validator.erase(patch.erased);
+    if (patch.first_added < map.size()) validator.insert(map, patch.first_added);
+    for (std::size_t i : patch.changed) validator.update(i, map[i]);
+    for (std::size_t i : patch.retargeted) validator.update(i, map[i]);
+
+    // erasing and appending nodes invalidates iterators - edits in place don't
+    if (erased != 0 || added != 0) selection.clear();
+    highlight_path.clear();
+    path_index_dirty = true;
+    rerouteArcs();
+    rebuildGroups();
+    path_timer->start();
+
+    QString message = QString("Reloaded %1: %2 nodes changed").arg(QFileInfo(file_path).fileName()).arg(diff.size());
+    if (!merge.conflicts.empty()) message += QString(" (%1 conflicting with unsaved changes - kept yours)").arg(merge.conflicts.size());
+    statusBar()->showMessage(message);
+    update();
+
+    // scripts are reported but applied regardless, as in the node editor
+    if (!script_errors.isEmpty()) QMessageBox::warning(this, "Script Errors", script_errors.join("\n"));
+    return true;
+}
+
+bool MainWindow::exportImage(const QString &path, qreal scale) const
+{
+    PROFILE_SCOPE("exportImage"); // (the profiler is only touched from this thread)
+
+    const QRectF bounds = mapBounds();
+    if (bounds.isEmpty() || !(scale > 0)) return false;
+
+    const qint64 width = qint64(std::ceil(bounds.width() * scale)), height = qint64(std::ceil(bounds.height() * scale));
+    if (width > std::numeric_limits<int>::max() || height > std::numeric_limits<int>::max()) return false;
+
+    const int cols = int((width + ExportTileSize - 1) / ExportTileSize);
+    const int rows = int((height + ExportTileSize - 1) / ExportTileSize);
+
+    // small enough images are stitched together in memory and saved as one file - anything bigger is saved tile by tile
+    const bool stitch = width * height <= ExportMaxStitchPixels;
+    QImage whole;
+    uchar *whole_bits = nullptr;
+    if (stitch)
+    {
+        whole = QImage(int(width), int(height), QImage::Format_ARGB32_Premultiplied);
+        if (whole.isNull()) return false;
+        whole_bits = whole.bits(); // (taken once, up front - the workers only write disjoint parts of it)
+    }
+    const QString tile_base = QFileInfo(path).path() + "/" + QFileInfo(path).completeBaseName();
+
+    // each worker renders whole tiles with its own painter and image, taking the next tile until there are none left
+    std::atomic<int> next_tile(0);
+    std::atomic<bool> ok(true);
+    auto worker = [&]()
+    {
+        QImage tile(ExportTileSize, ExportTileSize, QImage::Format_ARGB32_Premultiplied);
+        for (int t; ok && (t = next_tile++) < rows * cols; )
+        {
+            const int row = t / cols, col = t % cols;
+            const int x = col * ExportTileSize, y = row * ExportTileSize;
+            const int w = int(std::min<qint64>(ExportTileSize, width - x)), h = int(std::min<qint64>(ExportTileSize, height - y));
+
+            // the map area this tile covers
+            const QRectF area(bounds.topLeft() + QPointF(x, y) / scale, QSizeF(w, h) / scale);
+
+            tile.fill(ExportBackground);
+            {
+                QPainter painter(&tile);
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.scale(scale, scale);
+                painter.translate(-area.topLeft());
+                paintMap(painter, area, true);
+            }
+
+            if (stitch)
+            {
+                for (int r = 0; r < h; ++r)
+                    std::memcpy(whole_bits + std::size_t(y + r) * std::size_t(whole.bytesPerLine()) + std::size_t(x) * 4, tile.constScanLine(r), std::size_t(w) * 4);
+            }
+            else
+            {
+                QString tile_path = QString("%1_r%2_c%3.png").arg(tile_base).arg(row).arg(col);
+                if (!tile.copy(0, 0, w, h).save(tile_path, "PNG")) ok = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const unsigned thread_count = std::max(1u, std::min(std::thread::hardware_concurrency(), unsigned(rows * cols)));
+    for (unsigned i = 0; i < thread_count; ++i) workers.emplace_back(worker);
+    for (auto &i : workers) i.join();
+
+    if (!ok) return false;
+    return !stitch || whole.save(path, "PNG");
+}
+
+bool MainWindow::exportSvg(const QString &path) const
+{
+    PROFILE_SCOPE("exportSvg");
+
+    const QRectF bounds = mapBounds();
+    if (bounds.isEmpty()) return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    // everything is written straight to the file as it's generated
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(2);
+
+    const std::size_t node_count = groups_collapsed ? visible_nodes.size() : map.size();
+    auto nodeAt = [this](std::size_t k) { return groups_collapsed ? visible_nodes[k] : k; };
+
+    auto arrow = [&out](QPointF start, QPointF stop)
+    {
+        QPointF line_start, line_stop, head[3];
+        if (!arrowGeometry(start, stop, line_start, line_stop, head)) return;
+
+        out << "<line x1=\"" << line_start.x() << "\" y1=\"" << line_start.y()
+            << "\" x2=\"" << line_stop.x() << "\" y2=\"" << line_stop.y() << "\"/>"
+            << "<polygon stroke=\"none\" points=\"";
+        for (const QPointF &p : head) out << p.x() << ',' << p.y() << ' ';
+        out << "\"/>\n";
+    };
+    auto circle = [&out](QPointF center, qreal radius)
+    {
+        out << "<circle cx=\"" << center.x() << "\" cy=\"" << center.y() << "\" r=\"" << radius << "\"/>\n";
+    };
+    auto text = [&out](QPointF point, const QString &str)
+    {
+        out << "<text x=\"" << point.x() << "\" y=\"" << point.y() << "\">" << str.toHtmlEscaped() << "</text>\n";
+    };
+
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << bounds.width() << "\" height=\"" << bounds.height()
+        << "\" viewBox=\"" << bounds.left() << ' ' << bounds.top() << ' ' << bounds.width() << ' ' << bounds.height() << "\">\n";
+
+    // the arcs (and bundles)
+    out << "<g stroke=\"" << ArcPen.color().name() << "\" stroke-width=\"" << ArcPen.widthF() << "\" fill=\"" << ArcBrush.color().name() << "\">\n";
+    for (std::size_t k = 0; k < node_count; ++k)
+    {
+        std::size_t i = nodeAt(k);
+        QPointF start = map.columns().point(i);
+        for (const auto &arc : map[i].arcs)
+        {
+            if (arc.dest >= map.size())
+            {
+                QPointF stop = start + QPointF(0, 20);
+                out << "<line x1=\"" << start.x() << "\" y1=\"" << start.y() << "\" x2=\"" << stop.x() << "\" y2=\"" << stop.y() << "\"/>\n";
+            }
+            else if (!hiddenNode(arc.dest)) arrow(start, map.columns().point(arc.dest));
+        }
+    }
+    for (const auto &bundle : group_arcs) arrow(visualPoint(bundle.first.first), visualPoint(bundle.first.second));
+    out << "</g>\n";
+
+    // the nodes and collapsed groups
+    out << "<g stroke=\"" << NodePen.color().name() << "\" stroke-width=\"" << NodePen.widthF() << "\" fill=\"none\">\n";
+    for (std::size_t k = 0; k < node_count; ++k) circle(map.columns().point(nodeAt(k)), NodeRadius);
+    out << "</g>\n";
+    if (groups_collapsed)
+    {
+        out << "<g stroke=\"" << GroupNodePen.color().name() << "\" stroke-width=\"" << GroupNodePen.widthF() << "\" fill=\"none\">\n";
+        for (std::size_t g = 0; g < groups.size(); ++g)
+        {
+            if (group_visual[g] != g || group_sizes[g] == 0) continue;
+            circle(groups[g].point, NodeRadius);
+            circle(groups[g].point, NodeRadius - GroupRingInset);
+        }
+        out << "</g>\n";
+    }
+
+    // the labels
+    out << "<g font-family=\"sans-serif\" font-size=\"12\" fill=\"black\">\n";
+    for (std::size_t k = 0; k < node_count; ++k)
+    {
+        const Node_t &node = map[nodeAt(k)];
+        text(map.columns().point(nodeAt(k)), node.data.body_offset < 0 ? node.data.text : node.data.title);
+    }
+    if (groups_collapsed)
+    {
+        for (std::size_t g = 0; g < groups.size(); ++g)
+            if (group_visual[g] == g && group_sizes[g] != 0) text(groups[g].point, QString("%1 (%2)").arg(groups[g].title).arg(group_sizes[g]));
+    }
+    for (const auto &bundle : group_arcs)
+    {
+        if (bundle.second > 1) text((visualPoint(bundle.first.first) + visualPoint(bundle.first.second)) / 2, QString::number(bundle.second));
+    }
+    out << "</g>\n</svg>\n";
+
+    out.flush();
+    if (out.status() != QTextStream::Ok) { file.cancelWriting(); return false; }
+    return file.commit();
+}
+
+void MainWindow::mapReplaced()
+{
+    // recompile the scripts from scratch (errors are left for the node editor to report)
+    symbols.clear();
+    compileStory(map, symbols);
+
+    // everything derived from the old map is now invalid
+    selection.clear();
+    highlight_path.clear();
+    path_index_dirty = true;
+    rerouteArcs();
+    search_index_built = false;
+    search_index.clear();
+    view_offset = QPointF();
+    rebuildGroups();
+    minimap->rebuild();
+    validator.reset(map);
+
+    update();
+}
+
+void MainWindow::rerouteArcs()
+{
+    if (route_arcs) router.update(map);
+}
+
+void MainWindow::file_open()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Open Story", QString(), StoryFileFilter);
+    if (path.isEmpty()) return;
+
+    if (!openFile(path)) QMessageBox::warning(this, "Open Story", "Failed to open " + path);
+}
+void MainWindow::file_save()
+{
+    // if we don't have a file yet, this is a save as
+    if (file_path.isEmpty()) { file_save_as(); return; }
+
+    if (!saveFile(file_path)) QMessageBox::warning(this, "Save Story", "Failed to save " + file_path);
+}
+void MainWindow::file_save_as()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Save Story", file_path, StoryFileFilter);
+    if (path.isEmpty()) return;
+
+    if (!saveFile(path)) QMessageBox::warning(this, "Save Story", "Failed to save " + path);
+}
+
+void MainWindow::file_toggle_reload()
+{
+    reload_on_change = !reload_on_change;
+    watchFile();
+}
+void MainWindow::file_changed()
+{
+    if (!reload_on_change || file_path.isEmpty()) return;
+
+    // files replaced by renaming (as atomic saves do) drop out of the watcher, so pick the new one up
+    if (!file_watcher->files().contains(file_path) && QFileInfo::exists(file_path)) file_watcher->addPath(file_path);
+
+    // ignore our own saves (and changes that have already been applied)
+    QDateTime stamp = QFileInfo(file_path).lastModified();
+    if (stamp == file_stamp) return;
+
+    // if the file is unreadable it's probably still being written - the next change will retry
+    if (reloadFile()) file_stamp = stamp;
+}
+void MainWindow::file_export_image()
+{
+    if (map.size() == 0) return;
+
+    // ask for the resolution
+    bool ok;
+    double scale = QInputDialog::getDouble(this, "Export Image", "Pixels per map unit:", 1, 0.01, 100, 2, &ok);
+    if (!ok) return;
+
+    QString path = QFileDialog::getSaveFileName(this, "Export Image", QString(), "PNG Images (*.png)");
+    if (path.isEmpty()) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool done = exportImage(path, scale);
+    QApplication::restoreOverrideCursor();
+
+    if (!done) QMessageBox::warning(this, "Export Image", "Failed to export " + path);
+}
+void MainWindow::file_export_svg()
+{
+    if (map.size() == 0) return;
+
+    QString path = QFileDialog::getSaveFileName(this, "Export SVG", QString(), "SVG Images (*.svg)");
+    if (path.isEmpty()) return;
+
+    if (!exportSvg(path)) QMessageBox::warning(this, "Export SVG", "Failed to export " + path);
+}
+
+// ------------- //
+
 // -- utility -- //
 
 // ------------- //
@@ -112,70 +710,271 @@ bool MainWindow::intersects(QRectF rect, QPointF point)
             && point.y() >= rect.top() && point.y() <= rect.bottom();
 }
 
+QPointF MainWindow::toMap(QPointF point) const
+{
+    return point + view_offset;
+}
+void MainWindow::centerOn(QPointF point)
+{
+    view_offset = point - QPointF(width() / 2.0, height() / 2.0);
+    update();
+}
+
+void MainWindow::indexNode(std::size_t index)
+{
+    const Node_t &node = map[index];
+
+    QStringList fields;
+    fields << node.data.title << text_pager.text(node.data);
+    for (const auto &arc : node.arcs) fields << arc.data.text;
+
+    search_index.update(index, fields);
+}
+void MainWindow::unindexNodes(const std::vector<std::size_t> &indices)
+{
+    if (!search_index_built || indices.empty()) return;
+
+    // the search index renumbers every later node on each erase, so one node is patched and anything more is rebuilt lazily
+    if (indices.size() == 1) search_index.erase(indices.front());
+    else
+    {
+        search_index_built = false;
+        search_index.clear();
+    }
+}
+
+void MainWindow::rebuildGroups()
+{
+    PROFILE_SCOPE("rebuildGroups");
+
+    const std::size_t group_count = groups.size();
+    const auto &column = map.columns().group;
+
+    // find the outermost collapsed ancestor of each group (depth limited in case of a malformed cycle)
+    group_visual.assign(group_count, NoGroup);
+    for (std::size_t g = 0; g < group_count; ++g)
+    {
+        std::size_t depth = 0;
+        for (std::uint32_t a = std::uint32_t(g); a != NoGroup && depth <= group_count; a = groups[a].parent, ++depth)
+            if (groups[a].collapsed) group_visual[g] = a;
+    }
+
+    // count the nodes in each group (nested groups count toward all their ancestors)
+    group_sizes.assign(group_count, 0);
+    for (std::size_t i = 0; i < map.size(); ++i)
+    {
+        std::size_t depth = 0;
+        for (std::uint32_t a = column[i]; a != NoGroup && depth <= group_count; a = groups[a].parent, ++depth)
+            ++group_sizes[a];
+    }
+
+    // gather the nodes that are still shown
+    groups_collapsed = true; // so hiddenNode() looks at the groups
+    visible_nodes.clear();
+    group_arcs.clear();
+    for (std::size_t i = 0; i < map.size(); ++i) if (!hiddenNode(i)) visible_nodes.push_back(i);
+
+    // if nothing is hidden, everything can take the fast paths
+    groups_collapsed = visible_nodes.size() != map.size();
+    if (!groups_collapsed) { visible_nodes = std::vector<std::size_t>(); return; }
+
+    // bundle the arcs into and out of the collapsed groups
+    for (std::size_t i = 0; i < map.size(); ++i) bundleArcs(i, true);
+}
+
+bool MainWindow::inGroup(std::uint32_t group, std::uint32_t ancestor) const
+{
+    std::size_t depth = 0;
+    for (; group != NoGroup && depth <= groups.size(); group = groups[group].parent, ++depth)
+        if (group == ancestor) return true;
+    return false;
+}
+bool MainWindow::hiddenNode(std::size_t index) const
+{
+    if (!groups_collapsed) return false;
+
+    std::uint32_t g = map.columns().group[index];
+    return g != NoGroup && group_visual[g] != NoGroup;
+}
+qint64 MainWindow::visualOf(std::size_t index) const
+{
+    return hiddenNode(index) ? -qint64(group_visual[map.columns().group[index]]) - 1 : qint64(index);
+}
+QPointF MainWindow::visualPoint(qint64 visual) const
+{
+    return visual >= 0 ? map.columns().point(std::size_t(visual)) : groups[std::size_t(-visual - 1)].point;
+}
+void MainWindow::bundleArcs(std::size_t index, bool add)
+{
+    qint64 from = visualOf(index);
+    for (const auto &arc : map[index].arcs)
+    {
+        // terminal arcs are only shown for visible nodes
+        if (arc.dest >= map.size()) continue;
+
+        // arcs between visible nodes are drawn normally, and arcs inside a collapsed group aren't drawn at all
+        qint64 to = visualOf(arc.dest);
+        if ((from >= 0 && to >= 0) || from == to) continue;
+
+        auto key = std::make_pair(from, to);
+        if (add) ++group_arcs[key];
+        else
+        {
+            auto i = group_arcs.find(key);
+            if (i != group_arcs.end() && --i->second == 0) group_arcs.erase(i);
+        }
+    }
+}
+void MainWindow::revealNode(std::size_t index)
+{
+    if (!hiddenNode(index)) return;
+
+    std::size_t depth = 0;
+    for (std::uint32_t a = map.columns().group[index]; a != NoGroup && depth <= groups.size(); a = groups[a].parent, ++depth)
+        groups[a].collapsed = false;
+
+    rebuildGroups();
+}
+
+std::uint32_t MainWindow::overGroup(QPointF point) const
+{
+    if (!groups_collapsed) return NoGroup;
+
+    const auto sqr_radius = NodeRadius * NodeRadius;
+
+    // only the outermost collapsed groups (with something in them) are drawn
+    for (std::size_t g = 0; g < groups.size(); ++g)
+    {
+        if (group_visual[g] != g || group_sizes[g] == 0) continue;
+
+        QPointF d = point - groups[g].point;
+        if (d.x() * d.x() + d.y() * d.y() <= sqr_radius) return std::uint32_t(g);
+    }
+    return NoGroup;
+}
+
 MainWindow::Map_t::iterator MainWindow::overNode(QPointF point)
 {
+    PROFILE_SCOPE("overNode");
+
     // we'll do the distance comparison in terms of squares for speed
     const auto sqr_radius = NodeRadius * NodeRadius;
 
-    // for each node
-    QPointF d;
-    auto i = map.begin(), _end = map.end();
-    for (; i != _end; ++i)
+    // for each node (scanning the packed position columns)
+    const qreal *xs = map.columns().x.data(), *ys = map.columns().y.data();
+    const qreal px = point.x(), py = point.y();
+
+    // if some groups are collapsed, only the visible nodes are considered
+    if (groups_collapsed)
+    {
+        for (std::size_t i : visible_nodes)
+        {
+            qreal dx = px - xs[i], dy = py - ys[i];
+            if (dx * dx + dy * dy <= sqr_radius) return map.begin() + Map_t::difference_type(i);
+        }
+        return map.end();
+    }
+
+    std::size_t i = 0;
+    for (const std::size_t n = map.size(); i < n; ++i)
     {
         // compute position difference
-        d = point - i->data.point;
+        qreal dx = px - xs[i], dy = py - ys[i];
 
         // if we're within this node, stop searching
-        if (d.x() * d.x() + d.y() * d.y() <= sqr_radius) break;
+        if (dx * dx + dy * dy <= sqr_radius) break;
     }
 
     // return the found position
-    return i;
+    return map.begin() + Map_t::difference_type(i);
+}
+
+std::vector<std::size_t> MainWindow::nodesIn(QRectF rect) const
+{
+    const std::size_t n = map.size();
+    const qreal *xs = map.columns().x.data(), *ys = map.columns().y.data();
+    const qreal left = rect.left(), right = rect.right(), top = rect.top(), bottom = rect.bottom();
+
+    std::vector<std::size_t> res;
+
+    // if some groups are collapsed, only the visible nodes are considered
+    if (groups_collapsed)
+    {
+        for (std::size_t i : visible_nodes)
+            if (xs[i] >= left && xs[i] <= right && ys[i] >= top && ys[i] <= bottom) res.push_back(i);
+
+        // a collapsed group in the rectangle stands in for everything hidden in it
+        std::vector<char> hit(groups.size(), 0);
+        bool any = false;
+        for (std::size_t g = 0; g < groups.size(); ++g)
+        {
+            if (group_visual[g] != g || group_sizes[g] == 0 || !rect.contains(groups[g].point)) continue;
+            hit[g] = 1;
+            any = true;
+        }
+        if (any)
+        {
+            const std::size_t visible = res.size();
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                std::uint32_t g = map.columns().group[i];
+                if (g != NoGroup && group_visual[g] != NoGroup && hit[group_visual[g]]) res.push_back(i);
+            }
+            std::inplace_merge(res.begin(), res.begin() + std::ptrdiff_t(visible), res.end());
+        }
+        return res;
+    }
+
+    // flag the nodes in the rectangle (branch free, so it vectorizes)
+    std::vector<unsigned char> inside(n);
+    for (std::size_t i = 0; i < n; ++i)
+        inside[i] = (xs[i] >= left) & (xs[i] <= right) & (ys[i] >= top) & (ys[i] <= bottom);
+
+    // gather the flagged nodes
+    for (std::size_t i = 0; i < n; ++i) if (inside[i]) res.push_back(i);
+    return res;
 }
 
 void MainWindow::performSelect(QRectF rect, bool mod)
 {
+    PROFILE_SCOPE("performSelect");
+
+    // find all the nodes in the rectangle
+    auto hits = nodesIn(rect);
+
     // if we're modifying the current selection
     if (mod)
     {
-        // for each node
-        for (auto i = map.begin(), _end = map.end(); i != _end; ++i)
+        // for each node in the rectangle
+        for (std::size_t index : hits)
         {
-            // if this is in the rectangle
-            if (intersects(rect, i->data.point))
-            {
-                // find an equivalent item already in the selection
-                auto eq = std::find(selection.begin(), selection.end(), i);
+            auto i = map.begin() + Map_t::difference_type(index);
 
-                // if it's not in the selection, add it
-                if (eq == selection.end()) selection.push_back(i);
-                // otherwise it's already selected - remove it
-                else selection.erase(eq);
-            }
+            // find an equivalent item already in the selection
+            auto eq = std::find(selection.begin(), selection.end(), i);
+
+            // if it's not in the selection, add it
+            if (eq == selection.end()) selection.push_back(i);
+            // otherwise it's already selected - remove it
+            else selection.erase(eq);
         }
     }
     // otherwise we're starting a new selection
     else
     {
-        // clear the old selection
+        // replace the old selection with the nodes in the rectangle
         selection.clear();
-
-        // for each node
-        for (auto i = map.begin(), _end = map.end(); i != _end; ++i)
-        {
-            // if this is in the rectangle
-            if (intersects(rect, i->data.point))
-            {
-                // add it to the selection
-                selection.push_back(i);
-            }
-        }
+        selection.reserve(hits.size());
+        for (std::size_t index : hits) selection.push_back(map.begin() + Map_t::difference_type(index));
     }
 
+    updateHighlightPath();
     update();
 }
 void MainWindow::performSelect(Map_t::iterator node, bool mod)
 {
+    PROFILE_SCOPE("performSelect");
+
     // if we're modifying the current selection
     if (mod)
     {
@@ -196,87 +995,247 @@ void MainWindow::performSelect(Map_t::iterator node, bool mod)
         // add it to the selection
         selection.push_back(node);
     }
-
-    update();
+
+    updateHighlightPath();
+    update();
+}
+
+void MainWindow::updateHighlightPath()
+{
+    // we only highlight a path when exactly two nodes are selected
+    if (selection.size() != 2)
+    {
+        highlight_path.clear();
+        highlight_ends = {map.size(), map.size()};
+        return;
+    }
+
+    // the selection order depends on how it was made (a rect select is in index order), so the pair is unordered
+    std::size_t a = std::size_t(selection[0] - map.begin()), b = std::size_t(selection[1] - map.begin());
+    std::pair<std::size_t, std::size_t> ends = std::minmax(a, b);
+    if (!path_index_dirty && ends == highlight_ends) return;
+    highlight_ends = ends;
+
+    // rebuild the index if the map changed
+    if (path_index_dirty)
+    {
+        path_index.build(map, PathLandmarks);
+        path_index_dirty = false;
+    }
+
+    // show the shorter of the two directions
+    highlight_path = path_index.path(map, ends.first, ends.second);
+    auto back = path_index.path(map, ends.second, ends.first);
+    if (!back.empty() && (highlight_path.empty() || back.size() < highlight_path.size())) highlight_path = std::move(back);
+}
+
+// --------------- //
+
+// -- rendering -- //
+
+// --------------- //
+
+void MainWindow::paintNode(std::size_t index, QPainter &painter) const
+{
+    const Node_t &node = map[index];
+    QPointF point = map.columns().point(index);
+
+    painter.drawEllipse(QRectF(point.x() - NodeRadius, point.y() - NodeRadius, 2*NodeRadius, 2*NodeRadius));
+
+    // text that's still on disk isn't worth paging in just to draw it - show the title instead
+    painter.drawText(point, node.data.body_offset < 0 ? node.data.text : node.data.title);
+}
+void MainWindow::paintGroup(std::uint32_t group, QPainter &painter) const
+{
+    const StoryGroup &g = groups[group];
+
+    // a collapsed group is drawn as a node with a second ring inside
+    painter.drawEllipse(QRectF(g.point.x() - NodeRadius, g.point.y() - NodeRadius, 2*NodeRadius, 2*NodeRadius));
+    qreal inner = NodeRadius - GroupRingInset;
+    painter.drawEllipse(QRectF(g.point.x() - inner, g.point.y() - inner, 2*inner, 2*inner));
+
+    painter.drawText(g.point, QString("%1 (%2)").arg(g.title).arg(group_sizes[group]));
+}
+
+// returns true iff the bounding box of the segment a-b, inflated by <padding>, touches <area>
+static bool spans(QPointF a, QPointF b, QRectF area, qreal padding)
+{
+    return std::max(a.x(), b.x()) + padding >= area.left() && std::min(a.x(), b.x()) - padding <= area.right()
+            && std::max(a.y(), b.y()) + padding >= area.top() && std::min(a.y(), b.y()) - padding <= area.bottom();
+}
+
+void MainWindow::paintArrow(QPointF start, QPointF stop, QPainter &painter) const
+{
+    QPointF line_start, line_stop, head[3];
+    if (!arrowGeometry(start, stop, line_start, line_stop, head)) return;
+
+    painter.drawLine(line_start, line_stop);
+    painter.drawConvexPolygon(head, 3);
+}
+void MainWindow::paintArc(std::size_t from, const Arc_t &arc, QPainter &painter, const ArcRouter::Table *routes, bool off_thread) const
+{
+    // if this arc is valid, draw an arrow between the nodes
+    if (arc.dest < map.size())
+    {
+        const QPointF start = map.columns().point(from), stop = map.columns().point(arc.dest);
+
+        // draw along the route if there's a current one (the arc reference is into the node's arcs, so its offset is its index)
+        const ArcRouter::Route *route = routes ? routes->find(from, std::size_t(&arc - map[from].arcs.data()), start, stop) : nullptr;
+        if (!route) { paintArrow(start, stop, painter); return; }
+
+        // the curve mustn't be filled
+        QBrush brush = painter.brush();
+        painter.setBrush(Qt::NoBrush);
+        if (off_thread) painter.drawPath(route->copyPath());
+        else painter.drawPath(route->path);
+        painter.setBrush(brush);
+
+        QPointF head[3];
+        arrowHead(route->tip, route->dir, head);
+        painter.drawConvexPolygon(head, 3);
+    }
+    // otherwise is terminal
+    else
+    {
+        // draw a special terminal symbol
+        QPointF start(map.columns().point(from));
+        painter.drawLine(start, start + QPointF(0, 20));
+    }
 }
 
-// --------------- //
-
-// -- rendering -- //
+QRectF MainWindow::mapBounds() const
+{
+    const std::size_t node_count = groups_collapsed ? visible_nodes.size() : map.size();
+    bool empty = true;
+    qreal left = 0, right = 0, top = 0, bottom = 0;
 
-// --------------- //
+    auto include = [&](QPointF p)
+    {
+        if (empty) { left = right = p.x(); top = bottom = p.y(); empty = false; }
+        left = std::min(left, p.x()); right = std::max(right, p.x());
+        top = std::min(top, p.y()); bottom = std::max(bottom, p.y());
+    };
 
-void MainWindow::paintNode(const Node_t &node, QPainter &painter)
-{
-    painter.drawEllipse(QRectF(node.data.point.x() - NodeRadius, node.data.point.y() - NodeRadius, 2*NodeRadius, 2*NodeRadius));
+    for (std::size_t k = 0; k < node_count; ++k) include(map.columns().point(groups_collapsed ? visible_nodes[k] : k));
+    if (groups_collapsed)
+    {
+        for (std::size_t g = 0; g < groups.size(); ++g)
+            if (group_visual[g] == g && group_sizes[g] != 0) include(groups[g].point);
+    }
 
-    painter.drawText(node.data.point, node.data.text);
+    if (empty) return QRectF();
+    return inflate(QRectF(left, top, right - left, bottom - top), NodeRadius + ExportMargin);
 }
-void MainWindow::paintArc(const Node_t &from_node, const Arc_t &arc, QPainter &painter)
+
+MainWindow::PaintStats MainWindow::paintMap(QPainter &painter, QRectF area, bool off_thread) const
 {
-    // if this arc is valid
-    if (arc.dest < map.size())
-    {
-        // get the start and stop points
-        QPointF start(from_node.data.point), stop(map[arc.dest].data.point);
+    PaintStats stats;
 
-        QPointF dir = stop - start;
-        qreal mag = std::sqrt(dir.x() * dir.x() + dir.y() * dir.y());
+    // if some groups are collapsed, only the visible nodes are drawn (the hidden ones are skipped entirely)
+    const std::size_t node_count = groups_collapsed ? visible_nodes.size() : map.size();
+    auto nodeAt = [this](std::size_t k) { return groups_collapsed ? visible_nodes[k] : k; };
 
-        // if mag is such that the resulting line will be visible
-        if (mag >= 2 * NodeRadius)
-        {
-            dir /= mag; // normalize dir
-            QPointF right(-dir.y(), dir.x()); // create a vector pointing to the right of dir
+    // nodes are culled against the area grown by how far their text might reach
+    const QRectF node_area = inflate(area, NodeRadius + CullTextMargin);
+    const qreal *xs = map.columns().x.data(), *ys = map.columns().y.data();
 
-            // correct the start/stop points
-            start += dir * NodeRadius;
-            stop -= dir * NodeRadius;
+    // paint each node
+    painter.setBrush(NodeBrush);
+    painter.setPen(NodePen);
+    for (std::size_t k = 0; k < node_count; ++k)
+    {
+        std::size_t i = nodeAt(k);
+        if (xs[i] < node_area.left() || xs[i] > node_area.right() || ys[i] < node_area.top() || ys[i] > node_area.bottom()) continue;
 
-            // draw the corrected points
-            painter.drawLine(start, stop - dir * ArrowHeight);
+        paintNode(i, painter);
+        ++stats.nodes;
+    }
+
+    // paint each (outermost) collapsed group
+    painter.setBrush(GroupNodeBrush);
+    painter.setPen(GroupNodePen);
+    if (groups_collapsed)
+    {
+        for (std::size_t g = 0; g < groups.size(); ++g)
+            if (group_visual[g] == g && group_sizes[g] != 0 && node_area.contains(groups[g].point)) paintGroup(std::uint32_t(g), painter);
+    }
 
-            // draw the arrow head
-            QPointF arrow_points[] =
+    // paint each arc that crosses the area (arcs into collapsed groups are bundled below).
+    // routed arcs curve away from the line between their ends, so they're culled more loosely.
+    const std::shared_ptr<const ArcRouter::Table> routes = route_arcs ? router.routes() : nullptr;
+    const qreal arc_padding = routes ? RoutedArcMargin : NodeRadius;
+    painter.setBrush(ArcBrush);
+    painter.setPen(ArcPen);
+    for (std::size_t k = 0; k < node_count; ++k)
+    {
+        std::size_t i = nodeAt(k);
+        QPointF start(xs[i], ys[i]);
+        for (const auto &j : map[i].arcs)
+        {
+            if (j.dest < map.size())
             {
-                stop - dir * ArrowRecess,
-                stop - dir * ArrowHeight + right * ArrowWidth,
-                stop - dir * ArrowHeight - right * ArrowWidth,
-            };
-            painter.drawConvexPolygon(arrow_points, sizeof(arrow_points) / sizeof(arrow_points[0]));
+                if (hiddenNode(j.dest) || !spans(start, QPointF(xs[j.dest], ys[j.dest]), area, arc_padding)) continue;
+            }
+            else if (!spans(start, start + QPointF(0, 20), area, NodeRadius)) continue;
+
+            paintArc(i, j, painter, routes.get(), off_thread);
+            ++stats.arcs;
         }
     }
-    // otherwise is terminal
-    else
+
+    // paint the bundled arcs into/out of collapsed groups, labelled with how many arcs they stand for
+    for (const auto &bundle : group_arcs)
     {
-        // draw a special terminal symbol
-        QPointF start(from_node.data.point);
-        painter.drawLine(start, start + QPointF(0, 20));
+        QPointF start = visualPoint(bundle.first.first), stop = visualPoint(bundle.first.second);
+        if (!spans(start, stop, area, NodeRadius)) continue;
+
+        paintArrow(start, stop, painter);
+        if (bundle.second > 1) painter.drawText((start + stop) / 2, QString::number(bundle.second));
+        ++stats.arcs;
     }
+
+    return stats;
 }
 
 void MainWindow::paintEvent(QPaintEvent *e)
 {
-    // create a painter object
+    PROFILE_SCOPE("paintEvent");
+
+    // create a painter object (drawing in map coordinates)
     QPainter painter(this);
+    painter.translate(-view_offset);
 
-    // paint each node
-    painter.setBrush(NodeBrush);
-    painter.setPen(NodePen);
-    for (const auto &i : map) paintNode(i, painter);
+    // keep the minimap's viewport in sync (it only repaints if this changed)
+    minimap->setViewport(QRectF(view_offset, QSizeF(size())));
 
-    // paint each arc
-    painter.setBrush(ArcBrush);
-    painter.setPen(ArcPen);
-    for (const auto &i : map) for (const auto &j : i.arcs) paintArc(i, j, painter);
+    // paint the map (just what's in the window)
+    PaintStats stats = paintMap(painter, QRectF(view_offset, QSizeF(size())));
+    PROFILE_COUNT("nodes drawn", stats.nodes);
+    PROFILE_COUNT("arcs drawn", stats.arcs);
+
+    // paint the highlighted path (if any) over the arcs
+    const std::shared_ptr<const ArcRouter::Table> routes = route_arcs ? router.routes() : nullptr;
+    painter.setBrush(HighlightArcBrush);
+    painter.setPen(HighlightArcPen);
+    for (std::size_t i = 1; i < highlight_path.size(); ++i)
+    {
+        std::size_t from = highlight_path[i - 1];
+        if (hiddenNode(from) || hiddenNode(highlight_path[i])) continue;
+        for (const auto &j : map[from].arcs)
+            if (j.dest == highlight_path[i]) { paintArc(from, j, painter, routes.get()); break; }
+    }
 
     // for each selected node
     painter.setBrush(SelectedNodeBrush);
     painter.setPen(SelectedNodePen);
+    std::vector<char> halo_groups(groups_collapsed ? groups.size() : 0, 0); // the collapsed groups already given a halo
     for (auto i : selection)
     {
-        // draw a halo around it
-        painter.drawEllipse(QRectF(i->data.point.x() - SelectHaloRadius, i->data.point.y() - SelectHaloRadius,
+        // draw a halo around it (selected nodes hidden in a collapsed group share a halo around the group)
+        qint64 visual = visualOf(map.index(i));
+        if (visual < 0 && halo_groups[std::size_t(-visual - 1)]++) continue;
+        QPointF point = visualPoint(visual);
+        painter.drawEllipse(QRectF(point.x() - SelectHaloRadius, point.y() - SelectHaloRadius,
                                    2 * SelectHaloRadius, 2 * SelectHaloRadius));
     }
 
@@ -288,6 +1247,30 @@ void MainWindow::paintEvent(QPaintEvent *e)
         // paint the selection rect
         painter.drawRect(boundingRect(select_start, select_stop));
     }
+
+    PROFILE_FRAME();
+
+#ifdef UCHOOSE_PROFILING
+    // draw the profiling overlay (in window coordinates)
+    if (profile_overlay)
+    {
+        painter.resetTransform();
+        painter.setPen(OverlayTextPen);
+
+        QStringList lines = Profiler::instance().summary();
+        QFontMetrics metrics = painter.fontMetrics();
+        QRectF box(OverlayMargin, OverlayMargin, 0, OverlayMargin + lines.size() * metrics.height());
+        for (const QString &line : lines) box.setWidth(std::max(box.width(), metrics.boundingRect(line).width() + 2 * OverlayMargin));
+
+        painter.fillRect(box, OverlayBackground);
+        qreal y = box.top() + OverlayMargin / 2;
+        for (const QString &line : lines)
+        {
+            painter.drawText(QPointF(box.left() + OverlayMargin, y + metrics.ascent()), line);
+            y += metrics.height();
+        }
+    }
+#endif
 }
 
 // -------------- //
@@ -309,23 +1292,52 @@ void MainWindow::_begin_drag(Map_t::iterator node, QPointF mouse_start)
         // if the drag node is in the selection
         if (std::any_of(selection.begin(), selection.end(), [node](Map_t::iterator o){return o==node;}))
         {
-            // populate drag_info
-            drag_info.resize(selection.size());
-            for (std::size_t i = 0; i < selection.size(); ++i)
-                drag_info[i] = {selection[i], selection[i]->data.point};
+            // populate drag_info (selected nodes hidden in a collapsed group move with the group)
+            drag_info.clear();
+            drag_info.reserve(selection.size());
+            std::vector<char> dragged_groups(groups_collapsed ? groups.size() : 0, 0);
+            for (auto i : selection)
+            {
+                std::size_t index = map.index(i);
+                qint64 visual = visualOf(index);
+                if (visual >= 0) drag_info.push_back({index, map.columns().point(index), NoGroup});
+                else
+                {
+                    std::size_t group = std::size_t(-visual - 1);
+                    if (!dragged_groups[group]++) drag_info.push_back({0, groups[group].point, std::uint32_t(group)});
+                }
+            }
         }
         // otherwise drag node is not selected
         else
         {
             // only the dragged node will be dragged
             drag_info.resize(1);
-            drag_info[0] = {node, node->data.point};
+            drag_info[0] = {map.index(node), nodePoint(map, node), NoGroup};
         }
 
         // start the timer
         drag_timer_id = startTimer(DragSleepTime);
     }
 }
+void MainWindow::_begin_drag(std::uint32_t group, QPointF mouse_start)
+{
+    // for safety, only do this if we're not in a drag action
+    if (drag_timer_id == 0)
+    {
+        // record initial data
+        drag_start = mouse_start;
+        drag_stop = mouse_start;
+        drag_moved = false;
+
+        // only the group itself moves during the drag (its members follow at the end)
+        drag_info.resize(1);
+        drag_info[0] = {0, groups[group].point, group};
+
+        // start the timer
+        drag_timer_id = startTimer(DragSleepTime);
+    }
+}
 void MainWindow::_mid_drag(QPointF mouse_stop)
 {
     // for efficiency, only do this if the mouse moved
@@ -334,12 +1346,22 @@ void MainWindow::_mid_drag(QPointF mouse_stop)
         drag_stop = mouse_stop;
         drag_moved = true;
 
+        PROFILE_SCOPE("_mid_drag");
+
         // compute the net position difference
         QPointF dr = mouse_stop - drag_start;
 
         // perform the node repositioning
-        for (auto &i : drag_info)
-            i.node->data.point = i.origin + dr;
+        for (const auto &i : drag_info)
+        {
+            if (i.group != NoGroup) groups[i.group].point = i.origin + dr;
+            else
+            {
+                QPointF old = map.columns().point(i.node);
+                map.columns().point(i.node, i.origin + dr);
+                minimap->moveNode(old, i.origin + dr);
+            }
+        }
 
         // update display
         update();
@@ -356,6 +1378,27 @@ void MainWindow::_end_drag(QPointF mouse_stop)
 
         // perform the final node repositioning
         _mid_drag(mouse_stop);
+
+        // a dragged group carries everything in it along (done once here rather than every frame)
+        QPointF dr = drag_stop - drag_start;
+        for (const auto &i : drag_info)
+        {
+            if (i.group == NoGroup || dr == QPointF()) continue;
+
+            for (std::size_t j = 0; j < map.size(); ++j)
+            {
+                if (!inGroup(map.columns().group[j], i.group)) continue;
+
+                QPointF old = map.columns().point(j);
+                map.columns().point(j, old + dr);
+                minimap->moveNode(old, old + dr);
+            }
+            for (std::size_t g = 0; g < groups.size(); ++g)
+                if (g != i.group && inGroup(std::uint32_t(g), i.group)) groups[g].point += dr;
+        }
+
+        // the moved nodes' arcs are drawn straight until they're rerouted
+        rerouteArcs();
     }
 }
 void MainWindow::_cancel_drag()
@@ -423,15 +1466,24 @@ void MainWindow::prompt_editor(Map_t::iterator node)
 
     // provide editor with the current data
     editor.title(node->data.title);
-    editor.text(node->data.text);
-    for (const auto &arc : node->arcs) editor.addArc(arc.dest, arc.data.text);
+    editor.text(text_pager.text(node->data));
+    for (const auto &arc : node->arcs) editor.addArc(arc.dest, arc.data.text, arc.data.weight, arc.data.condition, arc.data.effect);
+
+    QStringList script_errors; // errors from compiling the arc scripts
 
     // if the user says ok, store the changes
     if (editor.exec() == QDialog::Accepted)
     {
+        PROFILE_SCOPE("prompt_editor"); // only time the commit (not the user)
+
         // save the new data
         node->data.title = editor.title();
         node->data.text = editor.text();
+        node->data.body_offset = -1; // the text is resident now
+
+        // the node's old arcs no longer contribute to the group bundles
+        const std::size_t index = map.index(node);
+        if (groups_collapsed) bundleArcs(index, false);
 
         node->arcs.clear();
         auto arcs = editor.getArcs();
@@ -442,57 +1494,479 @@ void MainWindow::prompt_editor(Map_t::iterator node)
 
             arc.dest = i.dest;
             arc.data.text = i.text;
+            arc.data.weight = i.weight;
+            arc.data.condition = i.condition;
+            arc.data.effect = i.effect;
+            compileArc(arc.data, symbols, &script_errors);
 
             node->arcs.push_back(arc);
         }
 
+        // the arcs changed - the path index is out of date
+        path_index_dirty = true;
+        rerouteArcs();
+        if (groups_collapsed) bundleArcs(index, true);
+        validator.update(index, *node);
+
+        // reindex the node's text
+        if (search_index_built) indexNode(index);
+        path_timer->start();
+
         // redraw with new data
         update();
     }
+
+    // the scripts are saved regardless, but let the user know they're broken
+    if (!script_errors.isEmpty()) QMessageBox::warning(this, "Script Errors", script_errors.join("\n"));
 }
 
 void MainWindow::openMainContext(QPoint point)
 {
     // store the context point
-    context_point = point;
+    context_point = toMap(point);
 
     // open the context menu (convert to screen coords)
-    background_context->popup(point + this->pos());
+    background_context->popup(mapToGlobal(point));
 }
 void MainWindow::background_context_add_node()
 {
     // create a default node
     Node_t node;
-    node.data.point = context_point;
+    node.data.uid = newNodeUid();
 
     // add it to the map
     map.emplace_back(std::move(node));
+    map.columns().point(map.size() - 1, context_point);
+    if (search_index_built) indexNode(map.size() - 1);
+    if (groups_collapsed) visible_nodes.push_back(map.size() - 1); // new nodes aren't in any group
+    minimap->addNode(context_point);
+    validator.insert(map, map.size() - 1);
 
     // THIS INVALIDATES ITERATORS - clear the selection
     selection.clear();
+    highlight_path.clear();
+    path_index_dirty = true;
+    rerouteArcs();
 
     // update the display
     update();
 }
 
+void MainWindow::tools_analyze_endings()
+{
+    if (map.size() == 0) return;
+
+    // start from the (first) selected node, or the first node if there's no selection
+    std::size_t start = selection.empty() ? 0 : std::size_t(selection.front() - map.begin());
+
+    auto res = analyze_endings(map, start, [](const Arc_t &arc) { return arc.data.weight; });
+
+    // gather the endings that can actually be reached, most likely first
+    std::vector<std::size_t> endings;
+    for (std::size_t i = 0; i < res.end_prob.size(); ++i) if (res.end_prob[i] > 0) endings.push_back(i);
+    std::sort(endings.begin(), endings.end(), [&res](std::size_t a, std::size_t b) { return res.end_prob[a] > res.end_prob[b]; });
+
+    constexpr std::size_t MaxListed = 20; // the maximum number of endings to list
+
+    QString msg = QString("Expected length: %1 choices\n").arg(res.expected_steps);
+    if (res.unresolved > 1e-9) msg += QString("Never ends: %1%\n").arg(res.unresolved * 100);
+    if (!res.converged) msg += "WARNING: solver did not converge\n";
+    msg += "\n";
+    for (std::size_t i = 0; i < endings.size() && i < MaxListed; ++i)
+    {
+        std::size_t e = endings[i];
+        msg += QString("%1 (%2): %3% after %4 choices\n").arg(map[e].data.title).arg(e)
+                .arg(res.end_prob[e] * 100).arg(res.end_steps[e]);
+    }
+    if (endings.size() > MaxListed) msg += QString("... and %1 more\n").arg(endings.size() - MaxListed);
+
+    QMessageBox::information(this, "Ending Analysis", msg);
+}
+
+void MainWindow::tools_select_within()
+{
+    if (selection.empty()) return;
+
+    // ask for the search depth
+    bool ok;
+    int depth = QInputDialog::getInt(this, "Select Within", "Number of choices:", 3, 0, std::numeric_limits<int>::max(), 1, &ok);
+    if (!ok) return;
+
+    // select everything within that many choices of the current selection
+    std::vector<std::size_t> sources;
+    for (auto i : selection) sources.push_back(std::size_t(i - map.begin()));
+
+    auto nodes = nodes_within(map, sources, std::size_t(depth));
+
+    selection.clear();
+    for (std::size_t i : nodes) if (!hiddenNode(i)) selection.push_back(map.begin() + Map_t::difference_type(i));
+
+    updateHighlightPath();
+    update();
+}
+
+void MainWindow::tools_generate_story()
+{
+    // ask for the size (everything else uses the defaults)
+    bool ok;
+    int nodes = QInputDialog::getInt(this, "Generate Synthetic Story", "Number of nodes:", 1000, 1, std::numeric_limits<int>::max(), 1000, &ok);
+    if (!ok) return;
+
+    _cancel_drag();
+    _cancel_select();
+
+    StoryGeneratorParams params;
+    params.nodes = std::size_t(nodes);
+    map = generateStory(params);
+    groups.clear();
+    text_pager.close();
+
+    // this isn't associated with a file anymore
+    file_path.clear();
+    file_base = Map_t();
+
+    mapReplaced();
+}
+
+void MainWindow::tools_toggle_arc_routing()
+{
+    route_arcs = !route_arcs;
+    rerouteArcs();
+    update();
+}
+void MainWindow::tools_toggle_profile_overlay()
+{
+    profile_overlay = !profile_overlay;
+    update();
+}
+void MainWindow::tools_export_trace()
+{
+#ifdef UCHOOSE_PROFILING
+    QString path = QFileDialog::getSaveFileName(this, "Export Performance Trace", QString(), "Trace Files (*.json)");
+    if (path.isEmpty()) return;
+
+    if (!Profiler::instance().exportTrace(path)) QMessageBox::warning(this, "Export Performance Trace", "Failed to write " + path);
+#endif
+}
+
+void MainWindow::edit_find()
+{
+    // ask for the search text
+    bool ok;
+    QString query = QInputDialog::getText(this, "Find", "Find nodes containing:", QLineEdit::Normal, QString(), &ok);
+    if (!ok || query.isEmpty()) return;
+
+    // build the index on first use (after that it's kept up to date as nodes are edited)
+    if (!search_index_built)
+    {
+        search_index.clear();
+        for (std::size_t i = 0; i < map.size(); ++i) indexNode(i);
+        search_index_built = true;
+    }
+
+    // look for words starting with the terms, and failing that, words containing them
+    auto hits = search_index.find(query, SearchIndex::Match::Prefix);
+    if (hits.empty()) hits = search_index.find(query, SearchIndex::Match::Substring);
+
+    statusBar()->showMessage(QString("%1 node(s) found").arg(hits.size()));
+    if (hits.empty()) return;
+
+    // open up any groups hiding the results
+    for (std::size_t i : hits) revealNode(i);
+
+    // select the results and center the view on them
+    selection.clear();
+    QPointF center;
+    for (std::size_t i : hits)
+    {
+        selection.push_back(map.begin() + Map_t::difference_type(i));
+        center += map.columns().point(i);
+    }
+    centerOn(center / qreal(hits.size()));
+
+    updateHighlightPath();
+    update();
+}
+
+void MainWindow::edit_group_selection()
+{
+    if (selection.empty()) return;
+    if (groups.size() >= NoGroup) return; // out of group ids
+
+    // ask for the group title
+    bool ok;
+    QString title = QInputDialog::getText(this, "Group Selection", "Group title:", QLineEdit::Normal, QString(), &ok);
+    if (!ok) return;
+
+    auto &column = map.columns().group;
+
+    // nest the new group in the group the selection is in (if it's all in the same one)
+    StoryGroup group;
+    group.title = title;
+    group.collapsed = true;
+    group.parent = column[map.index(selection.front())];
+    for (auto i : selection)
+    {
+        std::size_t index = map.index(i);
+        if (column[index] != group.parent) group.parent = NoGroup;
+        group.point += map.columns().point(index);
+    }
+    group.point /= qreal(selection.size());
+
+    // move the selection into the new group
+    groups.push_back(group);
+    for (auto i : selection) column[map.index(i)] = std::uint32_t(groups.size() - 1);
+
+    // the selection is hidden now
+    selection.clear();
+    highlight_path.clear();
+
+    rebuildGroups();
+    update();
+}
+void MainWindow::edit_collapse_groups()
+{
+    // collapse the (innermost) group of each selected node
+    for (auto i : selection)
+    {
+        std::uint32_t g = map.columns().group[map.index(i)];
+        if (g != NoGroup) groups[g].collapsed = true;
+    }
+    rebuildGroups();
+
+    // drop everything that's been hidden from the selection
+    selection.erase(std::remove_if(selection.begin(), selection.end(), [this](Map_t::iterator i) { return hiddenNode(map.index(i)); }),
+                    selection.end());
+
+    updateHighlightPath();
+    update();
+}
+void MainWindow::edit_expand_groups()
+{
+    for (auto &group : groups) group.collapsed = false;
+
+    rebuildGroups();
+    update();
+}
+void MainWindow::edit_ungroup_selection()
+{
+    // move each selected node out to the group containing its current one
+    auto &column = map.columns().group;
+    for (auto i : selection)
+    {
+        std::size_t index = map.index(i);
+        if (column[index] != NoGroup) column[index] = groups[column[index]].parent;
+    }
+
+    rebuildGroups();
+    update();
+}
+
+std::vector<std::size_t> MainWindow::selectedIndices() const
+{
+    std::vector<std::size_t> res;
+    res.reserve(selection.size());
+    for (auto i : selection) res.push_back(map.index(i));
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+void MainWindow::eraseNodes(std::vector<std::size_t> indices)
+{
+    PROFILE_SCOPE("eraseNodes");
+
+    // abandon any in-progress actions (they hold iterators)
+    _cancel_drag();
+    _cancel_select();
+
+    for (std::size_t i : indices) minimap->removeNode(map.columns().point(i));
+
+    unindexNodes(indices);
+
+    map.erase(indices);
+    validator.erase(std::move(indices));
+
+    // THIS INVALIDATES ITERATORS - clear the selection
+    selection.clear();
+    highlight_path.clear();
+    path_index_dirty = true;
+    rerouteArcs();
+    rebuildGroups();
+
+    update();
+}
+
+void MainWindow::pasteSubgraph(const QByteArray &data, QPointF center, bool keep_external)
+{
+    PROFILE_SCOPE("pasteSubgraph");
+
+    // abandon any in-progress actions (they hold iterators)
+    _cancel_drag();
+    _cancel_select();
+
+    const std::size_t first = map.size();
+    if (loadSubgraph(map, data, center, keep_external) == 0)
+    {
+        statusBar()->showMessage("Nothing to paste");
+        return;
+    }
+
+    // bring everything derived from the map up to date with the new nodes (which aren't in any group)
+    QStringList script_errors;
+    std::vector<QPointF> points; // the pasted positions (for the minimap)
+    points.reserve(map.size() - first);
+    selection.clear();
+    for (std::size_t i = first; i < map.size(); ++i)
+    {
+        for (auto &arc : map[i].arcs) compileArc(arc.data, symbols, &script_errors);
+
+        if (search_index_built) indexNode(i);
+        if (groups_collapsed)
+        {
+            visible_nodes.push_back(i);
+            bundleArcs(i, true);
+        }
+        points.push_back(map.columns().point(i));
+    }
+    validator.insert(map, first);
+    minimap->updateNodes({}, {}, points);
+
+    // THIS INVALIDATES ITERATORS - select the pasted nodes
+    selection.reserve(map.size() - first);
+    for (std::size_t i = first; i < map.size(); ++i) selection.push_back(map.begin() + Map_t::difference_type(i));
+    highlight_path.clear();
+    path_index_dirty = true;
+    rerouteArcs();
+    path_timer->start();
+
+    statusBar()->showMessage(QString("Pasted %1 nodes").arg(map.size() - first));
+    update();
+
+    if (!script_errors.isEmpty()) QMessageBox::warning(this, "Script Errors", script_errors.join("\n"));
+}
+
+void MainWindow::edit_copy()
+{
+    if (selection.empty()) return;
+
+    auto mime = new QMimeData;
+    mime->setData(SubgraphMimeType, saveSubgraph(map, selectedIndices(), &text_pager));
+    QApplication::clipboard()->setMimeData(mime);
+}
+void MainWindow::edit_cut()
+{
+    if (selection.empty()) return;
+
+    edit_copy();
+    eraseNodes(selectedIndices());
+}
+void MainWindow::pasteClipboard(bool keep_external)
+{
+    const QMimeData *mime = QApplication::clipboard()->mimeData();
+    if (!mime || !mime->hasFormat(SubgraphMimeType)) return;
+
+    // paste under the mouse if it's over the window, otherwise in the middle of the view
+    QPoint mouse = mapFromGlobal(QCursor::pos());
+    QPointF center = toMap(rect().contains(mouse) ? QPointF(mouse) : QPointF(rect().center()));
+
+    pasteSubgraph(mime->data(SubgraphMimeType), center, keep_external);
+}
+void MainWindow::edit_paste()
+{
+    pasteClipboard(true);
+}
+void MainWindow::edit_paste_internal()
+{
+    pasteClipboard(false);
+}
+void MainWindow::edit_duplicate()
+{
+    if (selection.empty()) return;
+
+    // place the copy just off the originals (bypassing the clipboard)
+    std::vector<std::size_t> indices = selectedIndices();
+    QPointF center;
+    for (std::size_t i : indices) center += map.columns().point(i);
+    center /= qreal(indices.size());
+
+    pasteSubgraph(saveSubgraph(map, indices, &text_pager), center + QPointF(DuplicateOffset, DuplicateOffset), true);
+}
+
+void MainWindow::edit_delete()
+{
+    if (selection.empty()) return;
+
+    eraseNodes(selectedIndices());
+}
+
+void MainWindow::diagnostics_changed()
+{
+    auto diagnostics = validator.diagnostics();
+
+    diagnostics_list->clear();
+    diagnostics_dock->setWindowTitle(QString("Diagnostics (%1)").arg(diagnostics.size()));
+
+    // the worker may be behind the map, so skip anything that no longer exists
+    int listed = 0;
+    for (const auto &d : diagnostics)
+    {
+        if (listed == MaxDiagnosticsListed) break;
+        if (d.node >= map.size()) continue;
+
+        auto item = new QListWidgetItem(QString("%1 (%2): %3").arg(map[d.node].data.title).arg(d.node).arg(describeDiagnostic(d.kinds)), diagnostics_list);
+        item->setData(Qt::UserRole, qulonglong(d.node));
+        ++listed;
+    }
+    if (diagnostics.size() > std::size_t(listed)) new QListWidgetItem(QString("... and %1 more").arg(diagnostics.size() - std::size_t(listed)), diagnostics_list);
+}
+void MainWindow::diagnostics_activated(QListWidgetItem *item)
+{
+    QVariant data = item->data(Qt::UserRole);
+    if (!data.isValid()) return;
+
+    std::size_t index = std::size_t(data.toULongLong());
+    if (index >= map.size()) return;
+
+    // select the node and bring it into view
+    revealNode(index);
+    selection.clear();
+    selection.push_back(map.begin() + Map_t::difference_type(index));
+    centerOn(map.columns().point(index));
+
+    updateHighlightPath();
+    update();
+}
+
+void MainWindow::path_changed()
+{
+    updateHighlightPath();
+    update();
+}
+
 void MainWindow::mousePressEvent(QMouseEvent *e)
 {
     // if this was a left click
     if (e->button() == Qt::LeftButton)
     {
         // get the node we're over (may not be)
-        auto node = overNode(e->pos());
+        auto node = overNode(toMap(e->pos()));
 
         // if we were over a node, begin a drag
-        if (node != map.end()) _begin_drag(node, e->pos());
-        // otherwise begin a selection
-        else _begin_select(e->pos());
+        if (node != map.end()) _begin_drag(node, toMap(e->pos()));
+        else
+        {
+            // if we were over a collapsed group, drag that instead
+            auto group = overGroup(toMap(e->pos()));
+            if (group != NoGroup) _begin_drag(group, toMap(e->pos()));
+            // otherwise begin a selection
+            else _begin_select(toMap(e->pos()));
+        }
     }
     // if this was a right click
     else if(e->button() == Qt::RightButton)
     {
         // get the node we're over (may not be)
-        auto node = overNode(e->pos());
+        auto node = overNode(toMap(e->pos()));
 
         // if we weren't over a node, open the main context menu
         if (node == map.end()) openMainContext(e->pos());
@@ -510,13 +1984,13 @@ void MainWindow::mouseReleaseEvent(QMouseEvent *e)
         {
             // record the drag_moved flag and end the drag action
             bool moved = drag_moved;
-            _end_drag(e->pos());
+            _end_drag(toMap(e->pos()));
 
             // if we didn't move
             if (!moved)
             {
                 // get the node we're over
-                auto node = overNode(e->pos());
+                auto node = overNode(toMap(e->pos()));
 
                 // perform a selection on it (sanity check for null)
                 if (node != map.end()) performSelect(node, QApplication::keyboardModifiers() & Qt::ControlModifier);
@@ -524,7 +1998,7 @@ void MainWindow::mouseReleaseEvent(QMouseEvent *e)
         }
 
         // if we were in a select action, end it
-        if (select_timer_id != 0) _end_select(e->pos());
+        if (select_timer_id != 0) _end_select(toMap(e->pos()));
     }
 
     e->accept();
@@ -539,10 +2013,21 @@ void MainWindow::mouseDoubleClickEvent(QMouseEvent *e)
         _cancel_drag();
 
         // get the node we're over (may not be)
-        auto node = overNode(e->pos());
+        auto node = overNode(toMap(e->pos()));
 
         // if we were over a node, open an editor for it
         if (node != map.end()) prompt_editor(node);
+        else
+        {
+            // if we were over a collapsed group, expand it
+            auto group = overGroup(toMap(e->pos()));
+            if (group != NoGroup)
+            {
+                groups[group].collapsed = false;
+                rebuildGroups();
+                update();
+            }
+        }
     }
 
     e->accept();
@@ -551,9 +2036,9 @@ void MainWindow::mouseDoubleClickEvent(QMouseEvent *e)
 void MainWindow::timerEvent(QTimerEvent *e)
 {
     // handle drag action
-    if (e->timerId() == drag_timer_id) _mid_drag(mapFromGlobal(QCursor::pos()));
+    if (e->timerId() == drag_timer_id) _mid_drag(toMap(mapFromGlobal(QCursor::pos())));
     // handle select action
-    else if(e->timerId() == select_timer_id) _mid_select(mapFromGlobal(QCursor::pos()));
+    else if(e->timerId() == select_timer_id) _mid_select(toMap(mapFromGlobal(QCursor::pos())));
 
     e->accept();
 }
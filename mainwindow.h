@@ -7,8 +7,24 @@
 #include <QPointF>
 #include <QTimerEvent>
 #include <QMenu>
-
-#include "adventure_map.h"
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QDockWidget>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDateTime>
+
+#include <map>
+#include <utility>
+#include <cstdint>
+
+#include "story.h"
+#include "adventure_paths.h"
+#include "searchindex.h"
+#include "storytextpager.h"
+#include "minimap.h"
+#include "storyvalidator.h"
+#include "arcrouter.h"
 
 namespace Ui {
 class MainWindow;
@@ -20,27 +36,23 @@ class MainWindow : public QMainWindow
 
 private: // -- types -- //
 
-    struct NodePayload
-    {
-        QPointF point;
-
-        QString title;
-        QString text;
-    };
-    struct ArcPayload
-    {
-        QString text;
-    };
-
-    typedef AdventureMap<NodePayload, ArcPayload> Map_t;
+    typedef StoryMap Map_t;
     typedef Map_t::Node Node_t;
     typedef Map_t::Arc  Arc_t;
 
     // the block of info used for drag events
     struct DragInfo
     {
-        Map_t::iterator node;   // the node being dragged
+        std::size_t     node;   // the node being dragged
         QPointF         origin; // the original position before the drag began
+        std::uint32_t   group;  // the collapsed group being dragged instead of a node (NoGroup if none)
+    };
+
+    // counts of what paintMap() drew
+    struct PaintStats
+    {
+        std::size_t nodes = 0;
+        std::size_t arcs = 0;
     };
 
 private: // -- data -- //
@@ -49,6 +61,29 @@ private: // -- data -- //
 
     Map_t map; // the adventure map to use for execution/rendering
 
+    QString file_path; // the file the map was loaded from / last saved to (empty if none)
+    Map_t   file_base; // the map as last loaded from / saved to file_path (what edits made since are relative to)
+
+    bool reload_on_change = false;     // whether changes to the file on disk are applied to the map as they happen
+    QFileSystemWatcher *file_watcher;  // watches file_path (while reload_on_change is set)
+    QTimer *reload_timer;              // delays reloading until the file has been quiet for a moment
+    QDateTime file_stamp;              // the modification time of the file as we last read/wrote it
+
+    ScriptSymbols symbols; // the story variables referenced by the map's arc scripts
+
+    StoryTextPager text_pager; // serves node text left on disk when a large story is opened
+
+    QPointF view_offset; // the map position shown at the top left corner of the window
+
+    std::vector<StoryGroup> groups; // the node groups (indexed by the map's group column)
+
+    // state derived from the groups (see rebuildGroups())
+    bool groups_collapsed = false;           // true iff any node is hidden in a collapsed group (the rest is unused otherwise)
+    std::vector<std::uint32_t> group_visual; // for each group, its outermost collapsed ancestor (or itself), NoGroup if it's shown expanded
+    std::vector<std::size_t> group_sizes;    // for each group, the number of nodes in it (including nested groups)
+    std::vector<std::size_t> visible_nodes;  // the (sorted) indices of the nodes not hidden in a collapsed group
+    std::map<std::pair<qint64, qint64>, std::size_t> group_arcs; // the arcs into/out of collapsed groups, bundled by (from, to) visual - see visualOf()
+
     int drag_timer_id = 0; // the timer for the drag updater (zero if we're not in a drag event)
     QPointF drag_start;    // the starting position of the drag
     QPointF drag_stop;     // the ending position of the drag
@@ -61,7 +96,27 @@ private: // -- data -- //
 
     std::vector<Map_t::iterator> selection; // all the nodes that are currently selected
 
-    QPoint context_point;      // the position of the currently-opened context menu
+    PathIndex path_index;           // landmark index for shortest path queries (rebuilt lazily)
+    bool path_index_dirty = true;   // marks that the map's arcs changed since the path index was built
+    QTimer *path_timer;             // delays updating the highlighted path until edits have been quiet for a moment
+    std::vector<std::size_t> highlight_path; // the shortest path between the two selected nodes, in whichever direction is shorter (empty if none)
+    std::pair<std::size_t, std::size_t> highlight_ends; // the (ordered) pair of nodes highlight_path was found for
+
+    SearchIndex search_index;          // full text index over node titles, text and arc labels
+    bool search_index_built = false;   // marks that search_index has been populated (it is built on first use)
+
+    bool profile_overlay = false; // marks that the profiling overlay should be drawn (only with UCHOOSE_PROFILING)
+
+    Minimap *minimap; // the overview panel (owned by its dock widget)
+
+    StoryValidator validator;         // checks the map for problems in the background (told about every edit)
+    QDockWidget *diagnostics_dock;    // the panel listing the validator's diagnostics
+    QListWidget *diagnostics_list;    // the list in diagnostics_dock
+
+    ArcRouter router;                 // routes the arcs as bundled curves in the background (told about every layout change)
+    bool route_arcs = false;          // whether arcs are drawn along their routes (while off, the router isn't updated)
+
+    QPointF context_point;     // the (map) position of the currently-opened context menu
     QMenu *background_context; // the context menu to use for right clicking in the background
 
 public: // -- ctor / dtor / asgn -- //
@@ -69,6 +124,20 @@ public: // -- ctor / dtor / asgn -- //
     explicit MainWindow(QWidget *parent = nullptr);
     virtual ~MainWindow() override;
 
+public: // -- file io -- //
+
+    // loads the map from the given file, replacing the current one. returns true on success.
+    bool openFile(const QString &path);
+    // saves the map to the given file. returns true on success.
+    bool saveFile(const QString &path);
+
+    // renders the whole map (as currently shown) to a png at <scale> pixels per map unit. returns true on success.
+    // the image is drawn in tiles in parallel. images too big to hold in memory are written as a set of tile pngs
+    // (<path> with _r<row>_c<col> appended to the base name) instead of a single file.
+    bool exportImage(const QString &path, qreal scale) const;
+    // writes the whole map (as currently shown) to an svg file, streamed out as it's generated. returns true on success.
+    bool exportSvg(const QString &path) const;
+
 private: // -- helpers -- //
 
     // returns the smallest rectangle containing the specified points
@@ -79,9 +148,53 @@ private: // -- helpers -- //
     // returns true iff the rect intersects the given point
     static bool intersects(QRectF rect, QPointF point);
 
+    // converts a position in window coordinates to map coordinates
+    QPointF toMap(QPointF point) const;
+    // scrolls the view so that the given map position is in the center of the window
+    void centerOn(QPointF point);
+
+    // resets all the state derived from the map (call after replacing the whole map)
+    void mapReplaced();
+    // queues the arcs for rerouting, if arc routing is on (call after moving nodes or changing arcs)
+    void rerouteArcs();
+
+    // points the file watcher at file_path (or nothing, if reloading is off) and records its modification time
+    void watchFile();
+    // applies the changes made to file_path on disk to the map, touching only the nodes that differ.
+    // unsaved edits are kept: the file's changes are merged into them, with file_base as the common ancestor.
+    // returns false if the file couldn't be read (e.g. it's mid-write).
+    bool reloadFile();
+
+    // updates the search index entry for the given node
+    void indexNode(std::size_t index);
+    // drops the given nodes from the search index (call before erasing them from the map)
+    void unindexNodes(const std::vector<std::size_t> &indices);
+
+    // rebuilds the state derived from the groups (call after changing the groups, their membership, or the whole map)
+    void rebuildGroups();
+    // returns true iff <group> is <ancestor> or nested (at any depth) within it
+    bool inGroup(std::uint32_t group, std::uint32_t ancestor) const;
+    // returns true iff the given node is hidden in a collapsed group
+    bool hiddenNode(std::size_t index) const;
+    // returns what the given node is drawn as: its own index, or -(group + 1) for the collapsed group hiding it
+    qint64 visualOf(std::size_t index) const;
+    // returns the position of a visual (see visualOf())
+    QPointF visualPoint(qint64 visual) const;
+    // adds (<add> = true) or removes the arcs from the given node to/from group_arcs
+    void bundleArcs(std::size_t index, bool add);
+    // expands every group hiding the given node
+    void revealNode(std::size_t index);
+
+    // finds the collapsed group drawn at the given point. returns NoGroup if there is none.
+    std::uint32_t overGroup(QPointF point) const;
+
     // finds the (first) node that the given point is within. returns map.end() if there is no such node.
     Map_t::iterator overNode(QPointF point);
 
+    // returns the (sorted) indices of all the nodes whose centers are in the given rectangle.
+    // nodes hidden in a collapsed group are included iff the group's position is in the rectangle.
+    std::vector<std::size_t> nodesIn(QRectF rect) const;
+
     // performs a selection action for every node in the given rectangle.
     // if <mod> is false, clears the current selection and selects the items.
     // if <mod> is true, toggles items into / out of the selection.
@@ -89,12 +202,30 @@ private: // -- helpers -- //
     // as the performSelect() taking rect, but only affects a single node
     void performSelect(Map_t::iterator node, bool mod);
 
-    // helpers for painting nodes and arcs
-    void paintNode(const Node_t &node, QPainter &paint);
-    void paintArc(const Node_t &from_node, const Arc_t &arc, QPainter &paint);
+    // recomputes highlight_path from the current selection (rebuilding the path index if needed).
+    // does nothing if the selected pair and the arcs are unchanged since the last call.
+    void updateHighlightPath();
+
+    // returns the map area covered by everything that's drawn (empty if there's nothing)
+    QRectF mapBounds() const;
+
+    // paints the nodes, collapsed groups and arcs that could show up in <area> (map coordinates).
+    // this only reads the map, so several threads may paint at once (e.g. export tiles) - as long as every thread other
+    // than the owning one passes <off_thread>, so routed arcs are drawn from private paths (see ArcRouter::Route::copyPath()).
+    PaintStats paintMap(QPainter &painter, QRectF area, bool off_thread = false) const;
+
+    // helpers for painting nodes and arcs (by node index).
+    // arcs are drawn along their route in <routes> (if non-null) while it's current, and straight otherwise.
+    // <off_thread> is as for paintMap().
+    void paintNode(std::size_t index, QPainter &paint) const;
+    void paintArc(std::size_t from, const Arc_t &arc, QPainter &paint, const ArcRouter::Table *routes = nullptr, bool off_thread = false) const;
+    void paintGroup(std::uint32_t group, QPainter &paint) const;
+    // paints an arc arrow between two node positions
+    void paintArrow(QPointF start, QPointF stop, QPainter &paint) const;
 
     // these process node drag subactions
     void _begin_drag(Map_t::iterator node, QPointF mouse_start);
+    void _begin_drag(std::uint32_t group, QPointF mouse_start);
     void _mid_drag(QPointF mouse_stop);
     void _end_drag(QPointF mouse_stop);
     void _cancel_drag();
@@ -108,6 +239,15 @@ private: // -- helpers -- //
     // opens an editor interface for the given node
     void prompt_editor(Map_t::iterator node);
 
+    // returns the (sorted) indices of the selected nodes
+    std::vector<std::size_t> selectedIndices() const;
+    // erases the nodes at the given indices in one pass (and everything derived from them). clears the selection.
+    void eraseNodes(std::vector<std::size_t> indices);
+    // appends the nodes from saveSubgraph() data centered on <center> (see loadSubgraph()) and selects them
+    void pasteSubgraph(const QByteArray &data, QPointF center, bool keep_external);
+    // pastes the subgraph on the clipboard (if any) under the mouse, or in the middle of the view
+    void pasteClipboard(bool keep_external);
+
     // opens the main context menu at the specified point
     void openMainContext(QPoint point);
 
@@ -115,6 +255,38 @@ private slots: // -- private slot helpers -- //
 
     void background_context_add_node();
 
+    void file_open();
+    void file_save();
+    void file_save_as();
+    void file_export_image();
+    void file_export_svg();
+    void file_toggle_reload();
+    void file_changed();
+
+    void tools_analyze_endings();
+    void tools_select_within();
+    void tools_generate_story();
+    void tools_toggle_arc_routing();
+    void tools_toggle_profile_overlay();
+    void tools_export_trace();
+
+    void diagnostics_changed();
+    void diagnostics_activated(QListWidgetItem *item);
+
+    void edit_find();
+    void edit_copy();
+    void edit_cut();
+    void edit_paste();
+    void edit_paste_internal();
+    void edit_duplicate();
+    void edit_delete();
+    void edit_group_selection();
+    void edit_collapse_groups();
+    void edit_expand_groups();
+    void edit_ungroup_selection();
+
+    void path_changed();
+
 protected: // -- event overrides -- //
 
     virtual void paintEvent(QPaintEvent *e) override;
@@ -0,0 +1,233 @@
+#include <QPainter>
+
+#include <cmath>
+#include <algorithm>
+
+#include "minimap.h"
+#include "profiler.h"
+
+// -------------- //
+
+// -- settings -- //
+
+// -------------- //
+
+constexpr int   MinimapResolution = 256;  // the number of grid cells along the longer side of the map
+constexpr qreal MinimapPadding = 0.05;    // the fraction of the map size added around the nodes (so small moves don't rebuild)
+constexpr qreal MinimapMinPadding = 100;  // the minimum padding around the nodes (map units)
+
+const QColor MinimapBackground(Qt::white);
+const QColor MinimapNodeColor(Qt::black);
+
+const QBrush MinimapViewportBrush(Qt::NoBrush);
+const QPen   MinimapViewportPen(QBrush(0x2b8fef), 2);
+
+// returns the pixel for a grid cell holding <count> nodes (busier cells are darker)
+static QRgb shade(std::uint32_t count)
+{
+    if (count == 0) return qRgba(0, 0, 0, 0);
+    return qRgba(MinimapNodeColor.red(), MinimapNodeColor.green(), MinimapNodeColor.blue(), int(std::min<std::uint32_t>(255, 96 + 32 * std::min<std::uint32_t>(count, 8))));
+}
+
+// ----------------- //
+
+// -- ctor / dtor -- //
+
+// ----------------- //
+
+Minimap::Minimap(const StoryColumns &_columns, QWidget *parent) :
+    QWidget(parent),
+    columns(_columns)
+{}
+
+QSize Minimap::sizeHint() const
+{
+    return QSize(200, 200);
+}
+
+// --------------- //
+
+// -- interface -- //
+
+// --------------- //
+
+void Minimap::rebuild()
+{
+    PROFILE_SCOPE("Minimap::rebuild");
+
+    const std::size_t n = columns.x.size();
+
+    // find the extents of the nodes
+    qreal left = 0, right = 0, top = 0, bottom = 0;
+    if (n != 0)
+    {
+        auto xs = std::minmax_element(columns.x.begin(), columns.x.end());
+        auto ys = std::minmax_element(columns.y.begin(), columns.y.end());
+        left = *xs.first; right = *xs.second;
+        top = *ys.first; bottom = *ys.second;
+    }
+
+    // pad them so nodes near the edge can move a little without forcing another rebuild
+    qreal pad = std::max(MinimapMinPadding, std::max(right - left, bottom - top) * MinimapPadding);
+    bounds = QRectF(left - pad, top - pad, right - left + 2 * pad, bottom - top + 2 * pad);
+
+    // square cells, with the longer side at full resolution
+    cell_size = std::max(bounds.width(), bounds.height()) / MinimapResolution;
+    grid_width = std::max(1, int(std::ceil(bounds.width() / cell_size)));
+    grid_height = std::max(1, int(std::ceil(bounds.height() / cell_size)));
+
+    // bin the nodes
+    counts.assign(std::size_t(grid_width) * std::size_t(grid_height), 0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        int cell = cellOf(columns.point(i));
+        if (cell >= 0) ++counts[std::size_t(cell)];
+    }
+
+    // render the counts
+    image = QImage(grid_width, grid_height, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    for (int cell = 0; cell < int(counts.size()); ++cell)
+        if (counts[std::size_t(cell)] != 0) image.setPixel(cell % grid_width, cell / grid_width, shade(counts[std::size_t(cell)]));
+
+    update();
+}
+
+void Minimap::addNode(QPointF point)
+{
+    int cell = cellOf(point);
+    if (cell < 0) { rebuild(); return; }
+
+    bump(cell, 1);
+    update();
+}
+void Minimap::removeNode(QPointF point)
+{
+    int cell = cellOf(point);
+    if (cell < 0) return; // never counted
+
+    bump(cell, -1);
+    update();
+}
+void Minimap::moveNode(QPointF from, QPointF to)
+{
+    int to_cell = cellOf(to);
+    if (to_cell < 0) { rebuild(); return; }
+
+    // most moves stay within a cell
+    int from_cell = cellOf(from);
+    if (from_cell == to_cell) return;
+
+    if (from_cell >= 0) bump(from_cell, -1);
+    bump(to_cell, 1);
+    update();
+}
+void Minimap::updateNodes(const std::vector<QPointF> &removed, const std::vector<std::pair<QPointF, QPointF>> &moved,
+                          const std::vector<QPointF> &added)
+{
+    // a rebuild counts every node where it is now, so it covers the whole batch
+    for (const auto &m : moved) if (cellOf(m.second) < 0) { rebuild(); return; }
+    for (QPointF p : added) if (cellOf(p) < 0) { rebuild(); return; }
+
+    for (QPointF p : removed)
+    {
+        int cell = cellOf(p);
+        if (cell >= 0) bump(cell, -1); // never counted otherwise
+    }
+    for (const auto &m : moved)
+    {
+        int from_cell = cellOf(m.first), to_cell = cellOf(m.second);
+        if (from_cell == to_cell) continue;
+
+        if (from_cell >= 0) bump(from_cell, -1);
+        bump(to_cell, 1);
+    }
+    for (QPointF p : added) bump(cellOf(p), 1);
+    update();
+}
+
+void Minimap::setViewport(QRectF rect)
+{
+    if (viewport != rect)
+    {
+        viewport = rect;
+        update();
+    }
+}
+
+// ------------- //
+
+// -- helpers -- //
+
+// ------------- //
+
+int Minimap::cellOf(QPointF point) const
+{
+    qreal x = std::floor((point.x() - bounds.left()) / cell_size);
+    qreal y = std::floor((point.y() - bounds.top()) / cell_size);
+
+    // written so nan fails too
+    if (!(x >= 0 && x < grid_width && y >= 0 && y < grid_height)) return -1;
+    return int(y) * grid_width + int(x);
+}
+void Minimap::bump(int cell, int delta)
+{
+    std::uint32_t &count = counts[std::size_t(cell)];
+    if (delta < 0 && count < std::uint32_t(-delta)) count = 0;
+    else count = std::uint32_t(qint64(count) + delta);
+
+    image.setPixel(cell % grid_width, cell / grid_width, shade(count));
+}
+
+QPointF Minimap::toMap(QPointF point) const
+{
+    if (target.isEmpty()) return bounds.center();
+
+    qreal scale = cell_size * grid_width / target.width(); // map units per widget pixel
+    return bounds.topLeft() + (point - target.topLeft()) * scale;
+}
+
+// --------------- //
+
+// -- rendering -- //
+
+// --------------- //
+
+void Minimap::paintEvent(QPaintEvent*)
+{
+    PROFILE_SCOPE("Minimap::paintEvent");
+
+    QPainter painter(this);
+    painter.fillRect(rect(), MinimapBackground);
+    if (image.isNull()) return;
+
+    // fit the cached image in the widget (keeping the aspect ratio) - just a scaled blit
+    qreal scale = std::min(width() / qreal(grid_width), height() / qreal(grid_height));
+    QSizeF size(grid_width * scale, grid_height * scale);
+    target = QRectF(QPointF((width() - size.width()) / 2, (height() - size.height()) / 2), size);
+    painter.drawImage(target, image);
+
+    // draw the main view's viewport on top
+    qreal k = scale / cell_size; // widget pixels per map unit
+    painter.setBrush(MinimapViewportBrush);
+    painter.setPen(MinimapViewportPen);
+    painter.drawRect(QRectF(target.topLeft() + (viewport.topLeft() - bounds.topLeft()) * k, viewport.size() * k));
+}
+
+// -------------- //
+
+// -- controls -- //
+
+// -------------- //
+
+void Minimap::mousePressEvent(QMouseEvent *e)
+{
+    if (e->button() == Qt::LeftButton) emit panRequested(toMap(e->pos()));
+    e->accept();
+}
+void Minimap::mouseMoveEvent(QMouseEvent *e)
+{
+    // (move events only arrive while a button is held, since mouse tracking is off)
+    if (e->buttons() & Qt::LeftButton) emit panRequested(toMap(e->pos()));
+    e->accept();
+}
@@ -0,0 +1,86 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QWidget>
+#include <QImage>
+#include <QRectF>
+#include <QPointF>
+#include <QPaintEvent>
+#include <QMouseEvent>
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "story.h"
+
+// an overview of the whole map with the main view's viewport drawn on top.
+// node positions are binned into a fixed resolution grid of counts, cached as an image with one pixel per cell.
+// moving a node only touches the two cells involved, and drawing just scales the image - so the cost doesn't
+// depend on the amount of text or the number of arcs (or, after the initial rebuild, the number of nodes).
+class Minimap : public QWidget
+{
+    Q_OBJECT
+
+private: // -- data -- //
+
+    const StoryColumns &columns; // the node positions to show (used for full rebuilds)
+
+    QRectF bounds;        // the map area covered by the grid
+    qreal  cell_size = 1; // the size of a grid cell (map units)
+    int    grid_width = 0, grid_height = 0;
+
+    std::vector<std::uint32_t> counts; // the number of nodes in each grid cell (row major)
+    QImage image;                      // the cached rendering of counts (one pixel per cell)
+
+    QRectF viewport; // the map area shown by the main view
+    QRectF target;   // where the image was last drawn in the widget
+
+public: // -- ctor / dtor / asgn -- //
+
+    explicit Minimap(const StoryColumns &columns, QWidget *parent = nullptr);
+
+public: // -- interface -- //
+
+    // recomputes the bounds and the whole grid from the node positions (call after replacing the map)
+    void rebuild();
+
+    // updates the grid for a node added at / removed from / moved between the given positions.
+    // positions outside the current bounds trigger a rebuild (so call these after updating the positions).
+    void addNode(QPointF point);
+    void removeNode(QPointF point);
+    void moveNode(QPointF from, QPointF to);
+    // as the above for a batch of nodes at once. if any new position is outside the current bounds this rebuilds once,
+    // rather than once per node.
+    void updateNodes(const std::vector<QPointF> &removed, const std::vector<std::pair<QPointF, QPointF>> &moved,
+                     const std::vector<QPointF> &added);
+
+    // sets the map area shown by the main view
+    void setViewport(QRectF rect);
+
+    virtual QSize sizeHint() const override;
+
+signals:
+
+    // emitted when the user clicks/drags in the minimap - the main view should center on <point> (map coordinates)
+    void panRequested(QPointF point);
+
+private: // -- helpers -- //
+
+    // returns the index of the grid cell containing the given position, or -1 if it's out of bounds
+    int cellOf(QPointF point) const;
+    // adds <delta> to the count of the given cell and updates its pixel
+    void bump(int cell, int delta);
+
+    // converts a position in widget coordinates to map coordinates
+    QPointF toMap(QPointF point) const;
+
+protected: // -- event overrides -- //
+
+    virtual void paintEvent(QPaintEvent *e) override;
+
+    virtual void mousePressEvent(QMouseEvent *e) override;
+    virtual void mouseMoveEvent(QMouseEvent *e) override;
+};
+
+#endif // MINIMAP_H
@@ -44,7 +44,7 @@ void NodeEditor::text(const QString &str)
     ui->TextText->setPlainText(str);
 }
 
-void NodeEditor::addArc(std::size_t dest, const QString &text)
+void NodeEditor::addArc(std::size_t dest, const QString &text, double weight, const QString &condition, const QString &effect)
 {
     // create the arc info container
     ArcInfoWidgets w;
@@ -56,6 +56,9 @@ void NodeEditor::addArc(std::size_t dest, const QString &text)
     w.layout->addWidget(w.check = new QCheckBox);
     w.layout->addWidget(w.dest = new QSpinBox);
     w.layout->addWidget(w.text = new QLineEdit);
+    w.layout->addWidget(w.weight = new QDoubleSpinBox);
+    w.layout->addWidget(w.condition = new QLineEdit);
+    w.layout->addWidget(w.effect = new QLineEdit);
 
     // add the layout object to display
     arcLayout->addLayout(w.layout);
@@ -66,6 +69,14 @@ void NodeEditor::addArc(std::size_t dest, const QString &text)
     w.dest->setMaximum(std::numeric_limits<int>::max());
     w.dest->setValue(int(dest));
     w.text->setText(text);
+    w.weight->setMinimum(0);
+    w.weight->setMaximum(1000000);
+    w.weight->setDecimals(3);
+    w.weight->setValue(weight);
+    w.condition->setText(condition);
+    w.condition->setPlaceholderText("condition");
+    w.effect->setText(effect);
+    w.effect->setPlaceholderText("effect");
 
     // add the widgets manager entry to the array
     arcInfo.push_back(w);
@@ -84,6 +95,9 @@ std::vector<NodeEditor::ArcInfo> NodeEditor::getArcs() const
             // populate its data
             arc.dest = decltype(arc.dest)(i.dest->value());
             arc.text = i.text->text();
+            arc.weight = i.weight->value();
+            arc.condition = i.condition->text();
+            arc.effect = i.effect->text();
 
             // add it to the list
             info.emplace_back(std::move(arc));
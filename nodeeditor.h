@@ -8,6 +8,7 @@
 #include <QVBoxLayout>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 #include <QCheckBox>
 
 #include <vector>
@@ -29,6 +30,11 @@ private: // -- implementation types -- //
         QCheckBox *check; // the widget representing if this arc should remain in the arc collection
         QSpinBox  *dest;  // the widget representing the dest state of an arc
         QLineEdit *text;  // the widget representing the text of an arc
+
+        QDoubleSpinBox *weight; // the widget representing the relative likelihood of an arc (used for analysis)
+
+        QLineEdit *condition; // the widget representing the condition script of an arc
+        QLineEdit *effect;    // the widget representing the effect script of an arc
     };
 
 public: // -- types -- //
@@ -38,6 +44,11 @@ public: // -- types -- //
     public:
         std::size_t dest; // the destination state for picking this arc
         QString     text; // the descriptive text for this arc
+
+        double weight; // the relative likelihood of picking this arc (used for analysis)
+
+        QString condition; // the condition script for this arc being available
+        QString effect;    // the effect script applied when picking this arc
     };
 
 private: // -- data -- //
@@ -65,7 +76,8 @@ public: // -- accessors -- //
     void text(const QString &str);
 
     // adds an arc info entry
-    void addArc(std::size_t dest, const QString &text);
+    void addArc(std::size_t dest, const QString &text, double weight = 1,
+                const QString &condition = QString(), const QString &effect = QString());
     // gets all the arc info entries.
     std::vector<ArcInfo> getArcs() const;
 
@@ -0,0 +1,157 @@
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "profiler.h"
+
+// -------------- //
+
+// -- settings -- //
+
+// -------------- //
+
+constexpr std::size_t SectionHistory = 256;  // the number of recent samples kept for each section
+constexpr std::size_t FrameHistory = 120;    // the number of recent frames used for the frame rate
+constexpr std::size_t EventHistory = 100000; // the number of recent events kept for trace export
+
+// ----------------- //
+
+// -- ctor / dtor -- //
+
+// ----------------- //
+
+Profiler::Profiler()
+{
+    clock.start();
+}
+
+Profiler &Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+// --------------- //
+
+// -- recording -- //
+
+// --------------- //
+
+void Profiler::record(const char *name, qint64 start, qint64 duration)
+{
+    // add to the section history
+    Section &sec = sections[name];
+    if (sec.samples.size() < SectionHistory) sec.samples.push_back(duration);
+    else sec.samples[sec.next] = duration;
+    sec.next = (sec.next + 1) % SectionHistory;
+
+    // add to the event history
+    Event e{name, start, duration};
+    if (events.size() < EventHistory) events.push_back(e);
+    else events[event_next] = e;
+    event_next = (event_next + 1) % EventHistory;
+}
+void Profiler::count(const char *name, qint64 value)
+{
+    frame_counts[name] += value;
+}
+void Profiler::endFrame()
+{
+    // publish the counters
+    last_counts.swap(frame_counts);
+    frame_counts.clear();
+
+    // record the frame time
+    if (frame_times.size() < FrameHistory) frame_times.push_back(now());
+    else frame_times[frame_next] = now();
+    frame_next = (frame_next + 1) % FrameHistory;
+}
+
+// ------------- //
+
+// -- queries -- //
+
+// ------------- //
+
+Profiler::Stats Profiler::stats(const char *name) const
+{
+    Stats res;
+
+    auto sec = sections.find(name);
+    if (sec == sections.end() || sec->second.samples.empty()) return res;
+
+    std::vector<qint64> s = sec->second.samples;
+    res.samples = s.size();
+
+    // percentiles by partial sorting
+    auto at = [&s](double q) -> double
+    {
+        auto pos = s.begin() + std::ptrdiff_t(q * double(s.size() - 1));
+        std::nth_element(s.begin(), pos, s.end());
+        return double(*pos) / 1e6;
+    };
+    res.p50 = at(0.50);
+    res.p99 = at(0.99);
+    res.max = double(*std::max_element(s.begin(), s.end())) / 1e6;
+
+    return res;
+}
+double Profiler::fps() const
+{
+    if (frame_times.size() < 2) return 0;
+
+    // the oldest and newest frames in the ring buffer
+    qint64 newest = frame_times[(frame_next + frame_times.size() - 1) % frame_times.size()];
+    qint64 oldest = frame_times.size() < FrameHistory ? frame_times.front() : frame_times[frame_next];
+
+    return newest > oldest ? double(frame_times.size() - 1) * 1e9 / double(newest - oldest) : 0;
+}
+qint64 Profiler::counter(const char *name) const
+{
+    auto c = last_counts.find(name);
+    return c != last_counts.end() ? c->second : 0;
+}
+
+QStringList Profiler::summary() const
+{
+    QStringList lines;
+
+    lines << QString("FPS: %1").arg(fps(), 0, 'f', 1);
+
+    for (const auto &sec : sections)
+    {
+        Stats s = stats(sec.first);
+        lines << QString("%1: p50 %2 ms, p99 %3 ms").arg(sec.first).arg(s.p50, 0, 'f', 3).arg(s.p99, 0, 'f', 3);
+    }
+    for (const auto &c : last_counts) lines << QString("%1: %2").arg(c.first).arg(c.second);
+
+    return lines;
+}
+
+bool Profiler::exportTrace(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
+
+    QTextStream out(&file);
+    out << "{\"traceEvents\": [\n";
+
+    // write the events oldest first (complete events, times in microseconds)
+    bool first = true;
+    for (std::size_t i = 0; i < events.size(); ++i)
+    {
+        const Event &e = events[events.size() < EventHistory ? i : (event_next + i) % EventHistory];
+
+        if (!first) out << ",\n";
+        first = false;
+
+        out << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+            << QString::number(double(e.start) / 1e3, 'f', 3) << ", \"dur\": " << QString::number(double(e.duration) / 1e3, 'f', 3) << "}";
+    }
+
+    out << "\n]}\n";
+    out.flush();
+
+    return out.status() == QTextStream::Ok;
+}
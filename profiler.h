@@ -0,0 +1,136 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+#include <map>
+#include <cstring>
+
+// lightweight scoped timers for the editor's hot paths.
+// profiling is only compiled in when UCHOOSE_PROFILING is defined (qmake CONFIG+=profiling) - otherwise the
+// PROFILE_* macros expand to nothing. the profiler is not thread safe and should only be used from the gui thread.
+
+#ifdef UCHOOSE_PROFILING
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// times the rest of the enclosing scope under the given name (must be a string literal)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+// adds <value> to the named counter for the current frame
+#define PROFILE_COUNT(name, value) Profiler::instance().count(name, qint64(value))
+// marks the end of a frame
+#define PROFILE_FRAME() Profiler::instance().endFrame()
+
+#else
+
+#define PROFILE_SCOPE(name) do {} while (false)
+#define PROFILE_COUNT(name, value) do { (void)(value); } while (false)
+#define PROFILE_FRAME() do {} while (false)
+
+#endif
+
+// collects timing samples and per-frame counters
+class Profiler
+{
+public: // -- types -- //
+
+    // summary statistics for a timed section (times in milliseconds)
+    struct Stats
+    {
+        double p50 = 0, p99 = 0, max = 0;
+        std::size_t samples = 0;
+    };
+
+private: // -- types -- //
+
+    // orders c strings by content (section names are literals, but the same literal may have several addresses)
+    struct NameLess
+    {
+        bool operator()(const char *a, const char *b) const { return std::strcmp(a, b) < 0; }
+    };
+
+    // a single timed event (for trace export)
+    struct Event
+    {
+        const char *name;
+        qint64 start;    // nanoseconds since the profiler was created
+        qint64 duration; // nanoseconds
+    };
+
+    // the recent history of a timed section
+    struct Section
+    {
+        std::vector<qint64> samples; // ring buffer of recent durations (nanoseconds)
+        std::size_t next = 0;        // the next slot to overwrite in samples
+    };
+
+private: // -- data -- //
+
+    QElapsedTimer clock; // the time base for all events
+
+    std::map<const char*, Section, NameLess> sections; // timing history by name
+
+    std::map<const char*, qint64, NameLess> frame_counts; // counters accumulating for the current frame
+    std::map<const char*, qint64, NameLess> last_counts;  // counters for the last completed frame
+
+    std::vector<qint64> frame_times; // ring buffer of recent frame end times (nanoseconds)
+    std::size_t frame_next = 0;      // the next slot to overwrite in frame_times
+
+    std::vector<Event> events; // ring buffer of recent events (for trace export)
+    std::size_t event_next = 0; // the next slot to overwrite in events
+
+private: // -- ctor / dtor / asgn -- //
+
+    Profiler();
+
+public: // -- interface -- //
+
+    // gets the (single) profiler instance
+    static Profiler &instance();
+
+    // gets the current time in nanoseconds (on the profiler's time base)
+    qint64 now() const { return clock.nsecsElapsed(); }
+
+    // records a timed event
+    void record(const char *name, qint64 start, qint64 duration);
+    // adds to the named counter for the current frame
+    void count(const char *name, qint64 value);
+    // marks the end of a frame (publishes the frame's counters)
+    void endFrame();
+
+    // gets timing statistics for a section (over its recent history)
+    Stats stats(const char *name) const;
+    // gets the recent frame rate (frames per second)
+    double fps() const;
+    // gets the value of a counter for the last completed frame
+    qint64 counter(const char *name) const;
+
+    // gets a human-readable summary (one entry per line) for display
+    QStringList summary() const;
+
+    // writes the recent events in chrome trace event (json) format. returns true on success.
+    bool exportTrace(const QString &path) const;
+};
+
+// times its own lifetime and records it with the profiler
+class ProfileScope
+{
+private: // -- data -- //
+
+    const char *name;
+    qint64 start;
+
+public: // -- ctor / dtor / asgn -- //
+
+    explicit ProfileScope(const char *_name) : name(_name), start(Profiler::instance().now()) {}
+    ~ProfileScope() { auto &p = Profiler::instance(); p.record(name, start, p.now() - start); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope &operator=(const ProfileScope&) = delete;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <iterator>
+
+#include "searchindex.h"
+
+// -- accessors -- //
+
+std::vector<QString> SearchIndex::tokenize(const QString &text)
+{
+    std::vector<QString> res;
+
+    // for each run of letters/digits
+    for (int i = 0, n = text.size(); i < n; )
+    {
+        // skip separators
+        while (i < n && !text[i].isLetterOrNumber()) ++i;
+
+        // find the end of the word
+        int start = i;
+        while (i < n && text[i].isLetterOrNumber()) ++i;
+
+        if (i > start) res.push_back(text.mid(start, i - start).toLower());
+    }
+
+    return res;
+}
+
+// -- modifiers -- //
+
+void SearchIndex::clear()
+{
+    postings.clear();
+    node_words.clear();
+}
+
+void SearchIndex::update(std::size_t node, const QStringList &fields)
+{
+    if (node >= node_words.size()) node_words.resize(node + 1);
+
+    // gather the new distinct words for the node
+    std::vector<QString> words;
+    for (const QString &field : fields)
+    {
+        auto w = tokenize(field);
+        words.insert(words.end(), std::make_move_iterator(w.begin()), std::make_move_iterator(w.end()));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    auto &old = node_words[node];
+
+    // remove the node from the words it no longer contains
+    std::vector<QString> removed;
+    std::set_difference(old.begin(), old.end(), words.begin(), words.end(), std::back_inserter(removed));
+    for (const QString &word : removed)
+    {
+        auto p = postings.find(word);
+        if (p == postings.end()) continue;
+
+        auto &list = p->second;
+        auto pos = std::lower_bound(list.begin(), list.end(), node);
+        if (pos != list.end() && *pos == node) list.erase(pos);
+
+        // drop words nothing uses anymore so they don't slow down substring scans
+        if (list.empty()) postings.erase(p);
+    }
+
+    // add the node to the words it newly contains
+    std::vector<QString> added;
+    std::set_difference(words.begin(), words.end(), old.begin(), old.end(), std::back_inserter(added));
+    for (const QString &word : added)
+    {
+        auto &list = postings[word];
+        list.insert(std::lower_bound(list.begin(), list.end(), node), node);
+    }
+
+    old = std::move(words);
+}
+
+void SearchIndex::erase(std::size_t node)
+{
+    if (node >= node_words.size()) return;
+
+    node_words.erase(node_words.begin() + std::ptrdiff_t(node));
+
+    // for each word, remove the node and account for the shift
+    for (auto p = postings.begin(); p != postings.end(); )
+    {
+        auto &list = p->second;
+
+        auto pos = std::lower_bound(list.begin(), list.end(), node);
+        if (pos != list.end() && *pos == node) pos = list.erase(pos);
+        for (; pos != list.end(); ++pos) --*pos;
+
+        if (list.empty()) p = postings.erase(p);
+        else ++p;
+    }
+}
+
+// -- queries -- //
+
+std::vector<std::size_t> SearchIndex::find(const QString &query, Match match) const
+{
+    std::vector<std::size_t> res;
+    bool first = true;
+
+    // for each term in the query
+    for (const QString &term : tokenize(query))
+    {
+        // gather all the nodes containing a matching word
+        std::vector<std::size_t> hits;
+        auto gather = [&hits](const std::vector<std::size_t> &list) { hits.insert(hits.end(), list.begin(), list.end()); };
+
+        if (match == Match::Prefix)
+        {
+            for (auto p = postings.lower_bound(term); p != postings.end() && p->first.startsWith(term); ++p) gather(p->second);
+        }
+        else
+        {
+            for (const auto &p : postings) if (p.first.contains(term)) gather(p.second);
+        }
+
+        std::sort(hits.begin(), hits.end());
+        hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+        // every term must match
+        if (first) { res = std::move(hits); first = false; }
+        else
+        {
+            std::vector<std::size_t> both;
+            std::set_intersection(res.begin(), res.end(), hits.begin(), hits.end(), std::back_inserter(both));
+            res = std::move(both);
+        }
+
+        if (res.empty()) break;
+    }
+
+    return res;
+}
@@ -0,0 +1,63 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+#include <map>
+
+// an inverted index from words to the nodes containing them.
+// words are runs of letters/digits and are compared case-insensitively.
+// the vocabulary is kept sorted, so prefix queries are a range scan and substring queries only touch each distinct word once.
+class SearchIndex
+{
+private: // -- data -- //
+
+    std::map<QString, std::vector<std::size_t>> postings; // word -> sorted list of the nodes containing it
+
+    std::vector<std::vector<QString>> node_words; // the distinct words currently indexed for each node
+
+public: // -- types -- //
+
+    // the kinds of matching a query term can use
+    enum class Match
+    {
+        Prefix,    // words beginning with the term
+        Substring, // words containing the term anywhere
+    };
+
+public: // -- ctor / dtor / asgn -- //
+
+    // constructs an empty index
+    SearchIndex() = default;
+
+public: // -- accessors -- //
+
+    // gets the number of nodes covered by the index
+    std::size_t size() const { return node_words.size(); }
+    // gets the number of distinct words in the index
+    std::size_t words() const { return postings.size(); }
+
+    // splits text into lowercase words (as used by the index)
+    static std::vector<QString> tokenize(const QString &text);
+
+public: // -- modifiers -- //
+
+    // removes everything from the index
+    void clear();
+
+    // sets the indexed content of the given node to the words in <fields> (replacing what was there before).
+    // nodes past the end are added (with any nodes in between left empty). cost is proportional to the node's word count.
+    void update(std::size_t node, const QStringList &fields);
+
+    // removes the given node from the index, shifting the indices of all the following nodes down (mirrors AdventureMap::erase).
+    void erase(std::size_t node);
+
+public: // -- queries -- //
+
+    // returns the sorted list of nodes that match every term in <query> (terms are the words of the query)
+    std::vector<std::size_t> find(const QString &query, Match match = Match::Prefix) const;
+};
+
+#endif // SEARCHINDEX_H
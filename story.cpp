@@ -0,0 +1,20 @@
+#include <random>
+#include <chrono>
+
+#include "story.h"
+
+quint64 newNodeUid()
+{
+    // seed from several sources so separate runs (e.g. writers on different branches) don't share a sequence
+    static std::mt19937_64 rng = []()
+    {
+        std::random_device device;
+        std::seed_seq seed{device(), device(), device(), device(),
+                           unsigned(std::chrono::high_resolution_clock::now().time_since_epoch().count())};
+        return std::mt19937_64(seed);
+    }();
+
+    quint64 uid;
+    do uid = rng(); while (uid == 0);
+    return uid;
+}
@@ -0,0 +1,114 @@
+#ifndef STORY_H
+#define STORY_H
+
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "adventure_map.h"
+#include "story_script.h"
+
+// the node and arc payloads used by the editor (and everything that loads/saves/analyzes its maps)
+
+// the data stored in each node (a question).
+// the node position is hot data for the editor's geometric passes, so it lives in StoryColumns instead.
+struct StoryNode
+{
+    quint64 uid = 0; // stable identity of the node across edits and versions of the story (0 if not assigned yet)
+
+    QString title;
+    QString text;
+
+    // where the text is stored in the story file if it wasn't loaded (see loadStoryStructure() and StoryTextPager).
+    // body_offset is -1 when <text> holds the actual text.
+    qint64  body_offset = -1;
+    quint32 body_size = 0; // size of the stored text (utf-8 bytes)
+};
+
+// the data stored in each arc (a choice)
+struct StoryArc
+{
+    QString text;
+
+    double weight = 1; // relative likelihood of this arc being picked (used for analysis)
+
+    QString condition; // script expression that must hold for this arc to be available (empty for always)
+    QString effect;    // script assignments applied to the story variables when this arc is taken
+
+    ScriptProgram condition_code; // compiled condition (see compileStory())
+    ScriptProgram effect_code;    // compiled effect (see compileStory())
+};
+
+// marks a node (or group) as not being in any group
+constexpr std::uint32_t NoGroup = std::numeric_limits<std::uint32_t>::max();
+
+// a group of nodes (e.g. a chapter) that the editor can collapse into a single node.
+// nodes refer to their (innermost) group by index - see StoryColumns::group. groups nest the same way.
+struct StoryGroup
+{
+    QString title;
+    QPointF point;                  // position of the group's node when it's collapsed
+    bool collapsed = false;
+    std::uint32_t parent = NoGroup; // the group containing this one
+};
+
+// the per-node columns (structure of arrays) of a story map - see AdventureMap
+struct StoryColumns
+{
+    std::vector<qreal> x, y;           // position of each node in the editor (packed for tight loops)
+    std::vector<std::uint32_t> group;  // the innermost group containing each node (NoGroup if none)
+
+    // gets/sets the position of the given node. no bounds checking.
+    QPointF point(std::size_t index) const { return QPointF(x[index], y[index]); }
+    void point(std::size_t index, QPointF p) { x[index] = p.x(); y[index] = p.y(); }
+
+    void push_back() { x.push_back(0); y.push_back(0); group.push_back(NoGroup); }
+    void erase(std::size_t index)
+    {
+        x.erase(x.begin() + std::ptrdiff_t(index));
+        y.erase(y.begin() + std::ptrdiff_t(index));
+        group.erase(group.begin() + std::ptrdiff_t(index));
+    }
+    void erase_marked(const std::vector<char> &marked)
+    {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < marked.size(); ++i)
+        {
+            if (marked[i]) continue;
+            x[kept] = x[i]; y[kept] = y[i]; group[kept] = group[i];
+            ++kept;
+        }
+        x.resize(kept); y.resize(kept); group.resize(kept);
+    }
+    void reserve(std::size_t count) { x.reserve(count); y.reserve(count); group.reserve(count); }
+};
+
+typedef AdventureMap<StoryNode, StoryArc, StoryColumns> StoryMap;
+
+// gets the position of the given node (forwards to StoryColumns::point(), for code that holds an iterator rather than an index)
+inline QPointF nodePoint(const StoryMap &map, StoryMap::const_iterator node) { return map.columns().point(map.index(node)); }
+
+// returns a new random node uid (never 0). random so that nodes added in different copies of a story don't collide.
+// not thread safe.
+quint64 newNodeUid();
+
+// compiles the condition and effect of an arc, adding any new variables to <symbols>.
+// returns true on success - otherwise the failing programs are marked invalid and the errors appended to <errors> (if non-null).
+bool compileArc(StoryArc &arc, ScriptSymbols &symbols, QStringList *errors = nullptr);
+// compiles every arc in the map (as compileArc()). returns true iff all of them compiled.
+bool compileStory(StoryMap &map, ScriptSymbols &symbols, QStringList *errors = nullptr);
+
+// calls <f>(arc) for each arc from <node> whose condition holds for the given story variables (in order).
+// <vars> must hold at least as many values as there are symbols. never allocates.
+template<typename F>
+void forEachAvailableArc(const StoryMap::Node &node, const ScriptValue *vars, F f)
+{
+    for (const auto &arc : node.arcs) if (testCondition(arc.data.condition_code, vars)) f(arc);
+}
+
+#endif // STORY_H
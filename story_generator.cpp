@@ -0,0 +1,89 @@
+#include <QStringList>
+
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "story_generator.h"
+
+// builds a vocabulary of pronounceable pseudo-words
+static QStringList makeVocabulary(std::mt19937 &rng, int count)
+{
+    static const char *const syllables[] =
+    {
+        "ka", "lo", "mi", "ra", "ne", "to", "su", "vi", "da", "fe",
+        "gor", "hal", "jin", "mor", "pel", "quin", "ral", "sor", "tal", "wen",
+    };
+    constexpr int syllable_count = int(sizeof(syllables) / sizeof(syllables[0]));
+
+    std::uniform_int_distribution<int> syl(0, syllable_count - 1), len(1, 4);
+
+    QStringList vocab;
+    for (int i = 0; i < count; ++i)
+    {
+        QString word;
+        for (int j = len(rng); j > 0; --j) word += syllables[syl(rng)];
+        vocab << word;
+    }
+    return vocab;
+}
+
+StoryMap generateStory(const StoryGeneratorParams &params)
+{
+    std::mt19937 rng(params.seed);
+
+    const QStringList vocab = makeVocabulary(rng, 1000);
+    const std::size_t n = params.nodes;
+    const std::size_t cols = std::max<std::size_t>(1, std::size_t(std::ceil(std::sqrt(double(n)))));
+
+    // arcs lead at most about two rows forward/backward, which keeps the map locally connected
+    const std::size_t reach = 2 * cols;
+
+    std::uniform_int_distribution<int> word(0, vocab.size() - 1);
+    std::uniform_int_distribution<std::size_t> hop(1, reach);
+    std::uniform_real_distribution<double> unit(0, 1);
+
+    const std::size_t whole_arcs = std::size_t(params.branching);
+    const double partial_arcs = params.branching - double(whole_arcs);
+
+    StoryMap map;
+    map.reserve(n);
+    map.state() = 0;
+
+    StoryMap::Node node;
+    StoryMap::Arc arc;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        node.data.uid = i + 1; // deterministic, like everything else here
+        node.data.title = QString("node %1").arg(i);
+
+        node.data.text.clear();
+        for (std::size_t w = 0; w < params.text_words; ++w)
+        {
+            if (w != 0) node.data.text += ' ';
+            node.data.text += vocab[word(rng)];
+        }
+
+        // generate the arcs
+        node.arcs.clear();
+        std::size_t arc_count = whole_arcs + (unit(rng) < partial_arcs ? 1 : 0);
+        for (std::size_t a = 0; a < arc_count; ++a)
+        {
+            double kind = unit(rng);
+
+            if (kind < params.ending_density) arc.dest = n; // terminal
+            else if (kind < params.ending_density + params.cycle_density) arc.dest = i - std::min(i, hop(rng));
+            else arc.dest = std::min(n, i + hop(rng)); // running off the end is terminal as well
+
+            arc.data.text = vocab[word(rng)];
+            node.arcs.push_back(arc);
+        }
+
+        map.push_back(node);
+
+        // lay out on the grid
+        map.columns().point(i, QPointF(double(i % cols) * params.spacing, double(i / cols) * params.spacing));
+    }
+
+    return map;
+}
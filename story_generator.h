@@ -0,0 +1,27 @@
+#ifndef STORY_GENERATOR_H
+#define STORY_GENERATOR_H
+
+#include <cstddef>
+
+#include "story.h"
+
+// parameters for generating synthetic story maps (for benchmarking and stress testing)
+struct StoryGeneratorParams
+{
+    std::size_t nodes = 1000;  // the number of nodes to generate
+    double branching = 2;      // mean number of arcs per node
+    double cycle_density = 0.1; // fraction of arcs that lead back to an earlier node
+    double ending_density = 0.05; // fraction of arcs that are terminal (end the story)
+    std::size_t text_words = 20; // number of words of text per node
+
+    double spacing = 80; // distance between neighboring nodes (nodes are laid out on a square grid)
+
+    unsigned seed = 0; // random seed (the same parameters always produce the same map)
+};
+
+// generates a synthetic story map.
+// arcs mostly lead a short way forward in node order (so the story flows across the grid), with some leading
+// backward to form cycles and some ending the story. titles are unique and text is drawn from a fixed pseudo-word vocabulary.
+StoryMap generateStory(const StoryGeneratorParams &params);
+
+#endif // STORY_GENERATOR_H
@@ -0,0 +1,304 @@
+#include <limits>
+#include <utility>
+#include <initializer_list>
+
+#include "story_script.h"
+#include "story.h"
+
+// ------------- //
+
+// -- symbols -- //
+
+// ------------- //
+
+std::size_t ScriptSymbols::slot(const QString &name)
+{
+    auto i = slots.find(name);
+    if (i != slots.end()) return i->second;
+
+    slots.emplace(name, names.size());
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+// -------------- //
+
+// -- compiler -- //
+
+// -------------- //
+
+namespace
+{
+    // thrown internally to abort compilation
+    struct ScriptError
+    {
+        QString what;
+    };
+
+    // a recursive descent compiler emitting bytecode as it parses
+    class ScriptCompiler
+    {
+    private: // -- data -- //
+
+        const QString &src;
+        int pos = 0; // the current position in src
+
+        ScriptSymbols &symbols;
+        std::vector<ScriptValue> &code;
+
+        std::size_t depth = 0; // the stack depth at the current point in the program
+
+    public: // -- ctor / dtor / asgn -- //
+
+        ScriptCompiler(const QString &_src, ScriptSymbols &_symbols, std::vector<ScriptValue> &_code)
+            : src(_src), symbols(_symbols), code(_code) {}
+
+    private: // -- lexing -- //
+
+        [[noreturn]] void fail(const QString &msg) const
+        {
+            throw ScriptError{QString("%1 (at column %2)").arg(msg).arg(pos + 1)};
+        }
+
+        void skipSpace()
+        {
+            while (pos < src.size() && src[pos].isSpace()) ++pos;
+        }
+
+        // returns true iff the next token is <tok> (and consumes it)
+        bool accept(const char *tok)
+        {
+            skipSpace();
+
+            QString t(tok);
+            if (src.mid(pos, t.size()) != t) return false;
+
+            // don't split two-character operators (e.g. accepting "<" from "<=", or "=" from "==")
+            if (t.size() == 1 && pos + 1 < src.size() && src[pos + 1] == '=' && QString("<>=!").contains(t[0])) return false;
+
+            pos += t.size();
+            return true;
+        }
+        void expect(const char *tok)
+        {
+            if (!accept(tok)) fail(QString("expected '%1'").arg(tok));
+        }
+
+        // reads an identifier (or returns an empty string if there isn't one)
+        QString identifier()
+        {
+            skipSpace();
+
+            int start = pos;
+            if (pos < src.size() && (src[pos].isLetter() || src[pos] == '_'))
+                while (pos < src.size() && (src[pos].isLetterOrNumber() || src[pos] == '_')) ++pos;
+
+            return src.mid(start, pos - start);
+        }
+
+    private: // -- code generation -- //
+
+        void emit(ScriptOp op)
+        {
+            code.push_back(ScriptValue(op));
+
+            // keep track of the stack depth (binary ops consume two and produce one)
+            if (op >= ScriptOp::Add) --depth;
+        }
+        void emit(ScriptOp op, ScriptValue arg)
+        {
+            code.push_back(ScriptValue(op));
+            code.push_back(arg);
+
+            if (op == ScriptOp::Store) --depth;
+            else if (++depth > MaxScriptStack) fail("expression is too complex");
+        }
+
+    private: // -- grammar -- //
+
+        // parses one precedence level of left-associative binary operators
+        void binary(void (ScriptCompiler::*next)(), std::initializer_list<std::pair<const char*, ScriptOp>> ops)
+        {
+            (this->*next)();
+            for (bool found = true; found; )
+            {
+                found = false;
+                for (const auto &op : ops)
+                {
+                    if (accept(op.first))
+                    {
+                        (this->*next)();
+                        emit(op.second);
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        void primary()
+        {
+            skipSpace();
+
+            // parenthesized expression
+            if (accept("("))
+            {
+                orExpr();
+                expect(")");
+                return;
+            }
+
+            // integer literal
+            if (pos < src.size() && src[pos].isDigit())
+            {
+                qint64 val = 0;
+                while (pos < src.size() && src[pos].isDigit())
+                {
+                    val = val * 10 + src[pos++].digitValue();
+                    if (val > std::numeric_limits<ScriptValue>::max()) fail("integer literal is too large");
+                }
+                emit(ScriptOp::Push, ScriptValue(val));
+                return;
+            }
+
+            // variable or boolean literal
+            QString name = identifier();
+            if (name.isEmpty()) fail("expected a value");
+
+            if (name == "true") emit(ScriptOp::Push, 1);
+            else if (name == "false") emit(ScriptOp::Push, 0);
+            else emit(ScriptOp::Load, ScriptValue(symbols.slot(name)));
+        }
+        void unary()
+        {
+            if (accept("!")) { unary(); emit(ScriptOp::Not); }
+            else if (accept("-")) { unary(); emit(ScriptOp::Neg); }
+            else primary();
+        }
+        void mulExpr() { binary(&ScriptCompiler::unary,   {{"*", ScriptOp::Mul}, {"/", ScriptOp::Div}, {"%", ScriptOp::Mod}}); }
+        void addExpr() { binary(&ScriptCompiler::mulExpr, {{"+", ScriptOp::Add}, {"-", ScriptOp::Sub}}); }
+        void relExpr() { binary(&ScriptCompiler::addExpr, {{"<=", ScriptOp::Le}, {">=", ScriptOp::Ge}, {"<", ScriptOp::Lt}, {">", ScriptOp::Gt}}); }
+        void eqExpr()  { binary(&ScriptCompiler::relExpr, {{"==", ScriptOp::Eq}, {"!=", ScriptOp::Ne}}); }
+        void andExpr() { binary(&ScriptCompiler::eqExpr,  {{"&&", ScriptOp::And}}); }
+        void orExpr()  { binary(&ScriptCompiler::andExpr, {{"||", ScriptOp::Or}}); }
+
+        void assignment()
+        {
+            QString name = identifier();
+            if (name.isEmpty() || name == "true" || name == "false") fail("expected a variable name");
+            ScriptValue slot = ScriptValue(symbols.slot(name));
+
+            // compound assignments load the old value first
+            static const std::pair<const char*, ScriptOp> compound[] =
+            {
+                {"+=", ScriptOp::Add}, {"-=", ScriptOp::Sub}, {"*=", ScriptOp::Mul}, {"/=", ScriptOp::Div}, {"%=", ScriptOp::Mod},
+            };
+            for (const auto &op : compound)
+            {
+                if (accept(op.first))
+                {
+                    emit(ScriptOp::Load, slot);
+                    orExpr();
+                    emit(op.second);
+                    emit(ScriptOp::Store, slot);
+                    return;
+                }
+            }
+
+            expect("=");
+            orExpr();
+            emit(ScriptOp::Store, slot);
+        }
+
+        void end()
+        {
+            skipSpace();
+            if (pos != src.size()) fail("unexpected character");
+        }
+
+    public: // -- interface -- //
+
+        void condition()
+        {
+            orExpr();
+            end();
+        }
+        void effect()
+        {
+            do
+            {
+                // allow empty statements (e.g. a trailing ';')
+                skipSpace();
+                if (pos == src.size() || src[pos] == ';') continue;
+
+                assignment();
+            }
+            while (accept(";"));
+            end();
+        }
+    };
+
+    // runs the given compiler entry point, handling errors
+    bool compile(void (ScriptCompiler::*entry)(), const QString &src, ScriptSymbols &symbols, ScriptProgram &prog, QString *error)
+    {
+        prog.code.clear();
+        prog.valid = true;
+
+        // blank sources compile to nothing
+        if (src.trimmed().isEmpty()) return true;
+
+        try
+        {
+            ScriptCompiler compiler(src, symbols, prog.code);
+            (compiler.*entry)();
+            return true;
+        }
+        catch (const ScriptError &e)
+        {
+            prog.code.clear();
+            prog.valid = false;
+            if (error) *error = e.what;
+            return false;
+        }
+    }
+}
+
+bool compileCondition(const QString &src, ScriptSymbols &symbols, ScriptProgram &prog, QString *error)
+{
+    return compile(&ScriptCompiler::condition, src, symbols, prog, error);
+}
+bool compileEffect(const QString &src, ScriptSymbols &symbols, ScriptProgram &prog, QString *error)
+{
+    return compile(&ScriptCompiler::effect, src, symbols, prog, error);
+}
+
+// ------------------- //
+
+// -- story helpers -- //
+
+// ------------------- //
+
+bool compileArc(StoryArc &arc, ScriptSymbols &symbols, QStringList *errors)
+{
+    bool ok = true;
+    QString error;
+
+    if (!compileCondition(arc.condition, symbols, arc.condition_code, &error))
+    {
+        ok = false;
+        if (errors) *errors << QString("condition '%1': %2").arg(arc.condition).arg(error);
+    }
+    if (!compileEffect(arc.effect, symbols, arc.effect_code, &error))
+    {
+        ok = false;
+        if (errors) *errors << QString("effect '%1': %2").arg(arc.effect).arg(error);
+    }
+
+    return ok;
+}
+bool compileStory(StoryMap &map, ScriptSymbols &symbols, QStringList *errors)
+{
+    bool ok = true;
+    for (auto &node : map) for (auto &arc : node.arcs) ok &= compileArc(arc.data, symbols, errors);
+    return ok;
+}
@@ -0,0 +1,133 @@
+#ifndef STORY_SCRIPT_H
+#define STORY_SCRIPT_H
+
+#include <QString>
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// story variables and the small expression language used for arc conditions and effects.
+// expressions are compiled once into bytecode for a stack vm, so evaluating them never allocates.
+//
+// all values are 32-bit integers (booleans are 0/1, and any non-zero value is true). variables start at 0.
+//     condition: an expression, e.g.   has_key && gold >= 10
+//     effect:    assignments separated by ';', e.g.   gold -= 10; has_key = 1
+// operators (loosest to tightest): || && (== !=) (< <= > >=) (+ -) (* / %) (unary ! -)
+// division or modulus by zero yields 0. true and false are the literals 1 and 0.
+
+typedef std::int32_t ScriptValue;
+
+// the bytecode instructions (push/load/store take an operand in the following word)
+enum class ScriptOp : ScriptValue
+{
+    Push, Load, Store,
+    Not, Neg,
+    Add, Sub, Mul, Div, Mod,
+    Eq, Ne, Lt, Le, Gt, Ge,
+    And, Or,
+};
+
+constexpr std::size_t MaxScriptStack = 32; // the maximum vm stack depth a program may use
+
+// a compiled condition or effect
+struct ScriptProgram
+{
+    std::vector<ScriptValue> code; // the bytecode (empty for an empty source)
+
+    bool valid = true; // false if the source failed to compile (an invalid condition is never satisfied)
+};
+
+// the table of story variable names. each variable is assigned a fixed slot in the variable array.
+class ScriptSymbols
+{
+private: // -- data -- //
+
+    std::map<QString, std::size_t> slots; // name -> slot
+    std::vector<QString> names;          // slot -> name
+
+public: // -- accessors -- //
+
+    // gets the number of variables (the minimum size of a variable array)
+    std::size_t size() const { return names.size(); }
+
+    // gets the name of the variable in the given slot. no bounds checking.
+    const QString &name(std::size_t slot) const { return names[slot]; }
+
+    // gets the slot for the given variable, adding it if it doesn't exist
+    std::size_t slot(const QString &name);
+
+    // removes all the variables
+    void clear() { slots.clear(); names.clear(); }
+};
+
+// compiles a condition expression. an empty (or blank) source is always satisfied.
+// on failure, returns false, marks <prog> as invalid and (if non-null) sets <error> to a description of the problem.
+bool compileCondition(const QString &src, ScriptSymbols &symbols, ScriptProgram &prog, QString *error = nullptr);
+// compiles an effect (a ';'-separated list of assignments). an empty (or blank) source does nothing.
+// on failure, returns false, marks <prog> as invalid and (if non-null) sets <error> to a description of the problem.
+bool compileEffect(const QString &src, ScriptSymbols &symbols, ScriptProgram &prog, QString *error = nullptr);
+
+// executes a compiled program. <vars> must hold at least as many values as there were symbols when it was compiled.
+// returns the value left on the stack (the result of a condition), or 0 if there is none (an effect).
+inline ScriptValue runScript(const ScriptProgram &prog, ScriptValue *vars)
+{
+    ScriptValue stack[MaxScriptStack];
+    std::size_t top = 0; // the number of values on the stack
+
+    const ScriptValue *pc = prog.code.data(), *const end = pc + prog.code.size();
+    while (pc != end)
+    {
+        // binary ops pop b then a and push (a op b)
+        #define SCRIPT_BINARY(expr) { ScriptValue b = stack[--top], a = stack[top - 1]; stack[top - 1] = (expr); break; }
+
+        switch (ScriptOp(*pc++))
+        {
+        case ScriptOp::Push:  stack[top++] = *pc++; break;
+        case ScriptOp::Load:  stack[top++] = vars[*pc++]; break;
+        case ScriptOp::Store: vars[*pc++] = stack[--top]; break;
+
+        case ScriptOp::Not: stack[top - 1] = !stack[top - 1]; break;
+        case ScriptOp::Neg: stack[top - 1] = ScriptValue(0u - std::uint32_t(stack[top - 1])); break;
+
+        // arithmetic wraps rather than overflowing (done in unsigned to avoid undefined behavior)
+        case ScriptOp::Add: SCRIPT_BINARY(ScriptValue(std::uint32_t(a) + std::uint32_t(b)))
+        case ScriptOp::Sub: SCRIPT_BINARY(ScriptValue(std::uint32_t(a) - std::uint32_t(b)))
+        case ScriptOp::Mul: SCRIPT_BINARY(ScriptValue(std::uint32_t(a) * std::uint32_t(b)))
+        case ScriptOp::Div: SCRIPT_BINARY(b == 0 || (b == -1 && a == INT32_MIN) ? 0 : a / b)
+        case ScriptOp::Mod: SCRIPT_BINARY(b == 0 || b == -1 ? 0 : a % b)
+
+        case ScriptOp::Eq: SCRIPT_BINARY(a == b)
+        case ScriptOp::Ne: SCRIPT_BINARY(a != b)
+        case ScriptOp::Lt: SCRIPT_BINARY(a < b)
+        case ScriptOp::Le: SCRIPT_BINARY(a <= b)
+        case ScriptOp::Gt: SCRIPT_BINARY(a > b)
+        case ScriptOp::Ge: SCRIPT_BINARY(a >= b)
+
+        case ScriptOp::And: SCRIPT_BINARY(a && b)
+        case ScriptOp::Or:  SCRIPT_BINARY(a || b)
+        }
+
+        #undef SCRIPT_BINARY
+    }
+
+    return top != 0 ? stack[top - 1] : 0;
+}
+
+// returns true iff the condition is satisfied by the given variables (an empty condition always is)
+inline bool testCondition(const ScriptProgram &prog, const ScriptValue *vars)
+{
+    if (!prog.valid) return false;
+    if (prog.code.empty()) return true;
+
+    // conditions never store, so the cast is safe
+    return runScript(prog, const_cast<ScriptValue*>(vars)) != 0;
+}
+// applies an effect to the given variables (an invalid effect does nothing)
+inline void applyEffect(const ScriptProgram &prog, ScriptValue *vars)
+{
+    if (prog.valid) runScript(prog, vars);
+}
+
+#endif // STORY_SCRIPT_H
@@ -0,0 +1,387 @@
+#include <QStringList>
+
+#include <unordered_map>
+#include <algorithm>
+
+#include "storydiff.h"
+
+namespace
+{
+    // incremental 64-bit fnv-1a hash
+    class Hasher
+    {
+    private: // -- data -- //
+
+        quint64 h = 14695981039346656037ull;
+
+    public: // -- interface -- //
+
+        void add(const void *data, std::size_t size)
+        {
+            const unsigned char *p = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+        }
+        void add(quint64 value) { add(&value, sizeof(value)); }
+        void add(double value) { add(&value, sizeof(value)); }
+        void add(const QString &str)
+        {
+            // include the length so adjacent strings can't run together
+            add(quint64(str.size()));
+            add(str.constData(), std::size_t(str.size()) * sizeof(QChar));
+        }
+
+        quint64 value() const { return h; }
+    };
+
+    // the content of a node, reduced for fast comparison
+    struct Fingerprint
+    {
+        QPointF point;
+        quint64 title, text, arcs;
+    };
+
+    Fingerprint fingerprint(const StoryMap &map, std::size_t index)
+    {
+        const auto &node = map[index];
+
+        Fingerprint res;
+        res.point = map.columns().point(index);
+
+        Hasher title, text, arcs;
+        title.add(node.data.title);
+        text.add(node.data.text);
+        for (const auto &arc : node.arcs)
+        {
+            // arcs are identified by where they go, not by index
+            arcs.add(arc.dest < map.size() ? map[arc.dest].data.uid : quint64(0));
+            arcs.add(arc.data.text);
+            arcs.add(arc.data.weight);
+            arcs.add(arc.data.condition);
+            arcs.add(arc.data.effect);
+        }
+
+        res.title = title.value();
+        res.text = text.value();
+        res.arcs = arcs.value();
+        return res;
+    }
+    std::vector<Fingerprint> fingerprints(const StoryMap &map)
+    {
+        std::vector<Fingerprint> res;
+        res.reserve(map.size());
+        for (std::size_t i = 0; i < map.size(); ++i) res.push_back(fingerprint(map, i));
+        return res;
+    }
+
+    // returns the StoryNodeDiff::Change flags for the fields that differ
+    unsigned compare(const Fingerprint &a, const Fingerprint &b)
+    {
+        unsigned res = 0;
+        if (a.point != b.point) res |= StoryNodeDiff::Moved;
+        if (a.title != b.title) res |= StoryNodeDiff::TitleChanged;
+        if (a.text != b.text)   res |= StoryNodeDiff::TextChanged;
+        if (a.arcs != b.arcs)   res |= StoryNodeDiff::ArcsChanged;
+        return res;
+    }
+
+    // maps node uids to indices
+    typedef std::unordered_map<quint64, std::size_t> UidIndex;
+
+    UidIndex indexUids(const StoryMap &map)
+    {
+        UidIndex res;
+        res.reserve(map.size());
+        for (std::size_t i = 0; i < map.size(); ++i) res.emplace(map[i].data.uid, i);
+        return res;
+    }
+    std::size_t find(const UidIndex &index, quint64 uid)
+    {
+        auto i = index.find(uid);
+        return i == index.end() ? NoNode : i->second;
+    }
+
+    // decides one field of a three-way merge. returns true to take their value, false to keep ours.
+    // <base> is null if the node isn't in the base. sets <conflict> if both sides changed the field differently.
+    template<typename T>
+    bool takeTheirs(const T &ours, const T &theirs, const T *base, bool &conflict)
+    {
+        conflict = false;
+
+        if (ours == theirs) return false;
+        if (base && ours == *base) return true;   // only they changed it
+        if (base && theirs == *base) return false; // only we changed it
+
+        conflict = true;
+        return false;
+    }
+}
+
+// ---------- //
+
+// -- diff -- //
+
+// ---------- //
+
+std::vector<StoryNodeDiff> diffStories(const StoryMap &before, const StoryMap &after)
+{
+    const UidIndex after_index = indexUids(after);
+
+    std::vector<StoryNodeDiff> res;
+    std::vector<char> matched(after.size(), 0);
+
+    // find what happened to each old node
+    for (std::size_t i = 0; i < before.size(); ++i)
+    {
+        quint64 uid = before[i].data.uid;
+
+        std::size_t j = find(after_index, uid);
+        if (j == NoNode) { res.push_back({uid, StoryNodeDiff::Removed, i, NoNode}); continue; }
+        matched[j] = 1;
+
+        unsigned changes = compare(fingerprint(before, i), fingerprint(after, j));
+        if (changes != 0) res.push_back({uid, changes, i, j});
+    }
+
+    // anything left over is new
+    for (std::size_t j = 0; j < after.size(); ++j)
+        if (!matched[j]) res.push_back({after[j].data.uid, StoryNodeDiff::Added, NoNode, j});
+
+    return res;
+}
+
+// ----------- //
+
+// -- merge -- //
+
+// ----------- //
+
+StoryMerge mergeStories(const StoryMap &base, const StoryMap &ours, const StoryMap &theirs)
+{
+    const UidIndex base_index = indexUids(base), theirs_index = indexUids(theirs);
+    const std::vector<Fingerprint> fb = fingerprints(base), fo = fingerprints(ours), ft = fingerprints(theirs);
+
+    StoryMerge res;
+    StoryMap &map = res.map;
+    map.reserve(ours.size());
+    map.state() = 0;
+
+    // the map each merged node's arcs came from (their dests are still indices into it until the end)
+    std::vector<const StoryMap*> arc_source;
+    arc_source.reserve(ours.size());
+
+    // appends a copy of a node to the merged map
+    auto append = [&](const StoryMap &from, std::size_t index)
+    {
+        map.push_back(from[index]);
+        map.columns().point(map.size() - 1, from.columns().point(index));
+        if (&from == &ours) map.columns().group[map.size() - 1] = ours.columns().group[index];
+        arc_source.push_back(&from);
+    };
+
+    // merge our nodes (with theirs, where they have it)
+    std::vector<char> seen(theirs.size(), 0);
+    for (std::size_t o = 0; o < ours.size(); ++o)
+    {
+        const quint64 uid = ours[o].data.uid;
+        const std::size_t b = find(base_index, uid), t = find(theirs_index, uid);
+
+        // if they don't have it, either we added it or they removed it
+        if (t == NoNode)
+        {
+            if (b != NoNode)
+            {
+                // honor the removal unless we changed it
+                if (compare(fo[o], fb[b]) == 0) continue;
+                res.conflicts.push_back({uid, StoryNodeDiff::Removed});
+            }
+            append(ours, o);
+            continue;
+        }
+        seen[t] = 1;
+
+        append(ours, o);
+        const std::size_t k = map.size() - 1;
+        auto &node = map[k];
+
+        // merge each field on its own
+        unsigned conflicts = 0;
+        bool conflict;
+
+        if (takeTheirs(fo[o].point, ft[t].point, b != NoNode ? &fb[b].point : nullptr, conflict))
+            map.columns().point(k, ft[t].point);
+        if (conflict) conflicts |= StoryNodeDiff::Moved;
+
+        if (takeTheirs(fo[o].title, ft[t].title, b != NoNode ? &fb[b].title : nullptr, conflict))
+            node.data.title = theirs[t].data.title;
+        if (conflict) conflicts |= StoryNodeDiff::TitleChanged;
+
+        if (takeTheirs(fo[o].text, ft[t].text, b != NoNode ? &fb[b].text : nullptr, conflict))
+            node.data.text = theirs[t].data.text;
+        if (conflict) conflicts |= StoryNodeDiff::TextChanged;
+
+        if (takeTheirs(fo[o].arcs, ft[t].arcs, b != NoNode ? &fb[b].arcs : nullptr, conflict))
+        {
+            node.arcs = theirs[t].arcs;
+            arc_source[k] = &theirs;
+        }
+        if (conflict) conflicts |= StoryNodeDiff::ArcsChanged;
+
+        if (conflicts != 0) res.conflicts.push_back({uid, conflicts});
+    }
+
+    // add the nodes only they have - either they added them or we removed them
+    for (std::size_t t = 0; t < theirs.size(); ++t)
+    {
+        if (seen[t]) continue;
+
+        const quint64 uid = theirs[t].data.uid;
+        const std::size_t b = find(base_index, uid);
+        if (b != NoNode)
+        {
+            // honor the removal unless they changed it
+            if (compare(ft[t], fb[b]) == 0) continue;
+            res.conflicts.push_back({uid, StoryNodeDiff::Removed});
+        }
+        append(theirs, t);
+    }
+
+    // point the arcs at the merged nodes (by uid), dropping arcs to nodes that are gone
+    const UidIndex merged_index = indexUids(map);
+    for (std::size_t k = 0; k < map.size(); ++k)
+    {
+        const StoryMap &source = *arc_source[k];
+        auto &arcs = map[k].arcs;
+
+        std::size_t kept = 0;
+        for (std::size_t a = 0; a < arcs.size(); ++a)
+        {
+            auto &arc = arcs[a];
+            if (arc.dest >= source.size()) arc.dest = map.size(); // terminal
+            else
+            {
+                std::size_t dest = find(merged_index, source[arc.dest].data.uid);
+                if (dest == NoNode) { ++res.dropped_arcs; continue; }
+                arc.dest = dest;
+            }
+
+            if (kept != a) arcs[kept] = std::move(arc);
+            ++kept;
+        }
+        arcs.erase(arcs.begin() + std::ptrdiff_t(kept), arcs.end());
+    }
+
+    return res;
+}
+
+// ----------- //
+
+// -- patch -- //
+
+// ----------- //
+
+StoryPatch patchStory(StoryMap &live, const StoryMap &updated, const std::vector<StoryNodeDiff> &diff)
+{
+    StoryPatch res;
+
+    // erase the removed nodes in one pass, keeping the state on the same node
+    std::size_t added = 0;
+    for (const auto &d : diff)
+    {
+        if (d.changes & StoryNodeDiff::Removed) res.erased.push_back(d.old_index);
+        else if (d.changes & StoryNodeDiff::Added) ++added;
+    }
+    std::sort(res.erased.begin(), res.erased.end());
+
+    // returns the index a node had before the erase after it (NoNode if it was erased)
+    auto shifted = [&](std::size_t index)
+    {
+        auto i = std::lower_bound(res.erased.begin(), res.erased.end(), index);
+        if (i != res.erased.end() && *i == index) return NoNode;
+        return index - std::size_t(i - res.erased.begin());
+    };
+
+    if (!res.erased.empty())
+    {
+        std::size_t state = live.state() < live.size() ? shifted(live.state()) : live.state();
+        live.erase(res.erased);
+        live.state() = state == NoNode ? 0 : std::min(state, live.size());
+    }
+
+    // terminal arcs point one past the last node, so they have to move past the nodes about to be added
+    res.first_added = live.size();
+    const std::size_t end = live.size() + added;
+    if (added != 0)
+    {
+        for (std::size_t i = 0; i < live.size(); ++i)
+        {
+            bool moved = false;
+            for (auto &arc : live[i].arcs) if (arc.dest == res.first_added) { arc.dest = end; moved = true; }
+            if (moved) res.retargeted.push_back(i);
+        }
+        if (live.state() == res.first_added) live.state() = end;
+    }
+
+    // append the added nodes (their arcs still use <updated>'s indices until below)
+    live.reserve(end);
+    for (const auto &d : diff)
+    {
+        if (!(d.changes & StoryNodeDiff::Added)) continue;
+
+        live.push_back(updated[d.new_index]);
+        live.columns().point(live.size() - 1, updated.columns().point(d.new_index));
+    }
+
+    // the live map now has exactly the nodes of <updated> - index both by uid
+    const UidIndex live_index = indexUids(live), updated_index = indexUids(updated);
+
+    // points an arc copied from <updated> at the live node with the same uid
+    auto remap = [&](StoryMap::Arc &arc)
+    {
+        arc.dest = arc.dest < updated.size() ? find(live_index, updated[arc.dest].data.uid) : live.size();
+        if (arc.dest == NoNode) arc.dest = live.size(); // can't happen for a consistent diff - end the story rather than dangle
+    };
+
+    // update the changed nodes in place
+    for (const auto &d : diff)
+    {
+        if (d.changes & (StoryNodeDiff::Added | StoryNodeDiff::Removed)) continue;
+
+        const std::size_t i = shifted(d.old_index);
+        if (i == NoNode) continue;
+        auto &node = live[i];
+        const auto &from = updated[d.new_index];
+
+        if (d.changes & StoryNodeDiff::Moved)        live.columns().point(i, updated.columns().point(d.new_index));
+        if (d.changes & StoryNodeDiff::TitleChanged) node.data.title = from.data.title;
+        if (d.changes & StoryNodeDiff::TextChanged)  node.data.text = from.data.text;
+        if (d.changes & StoryNodeDiff::ArcsChanged)
+        {
+            node.arcs = from.arcs;
+            for (auto &arc : node.arcs) remap(arc);
+        }
+        res.changed.push_back(i);
+    }
+    for (std::size_t i = res.first_added; i < live.size(); ++i) for (auto &arc : live[i].arcs) remap(arc);
+
+    // take the groups along with the group table
+    auto &group = live.columns().group;
+    for (std::size_t i = 0; i < live.size(); ++i)
+    {
+        std::size_t j = find(updated_index, live[i].data.uid);
+        group[i] = j == NoNode ? NoGroup : updated.columns().group[j];
+    }
+
+    return res;
+}
+
+QString describeChanges(unsigned changes)
+{
+    QStringList res;
+    if (changes & StoryNodeDiff::Added)        res << "added";
+    if (changes & StoryNodeDiff::Removed)      res << "removed";
+    if (changes & StoryNodeDiff::Moved)        res << "moved";
+    if (changes & StoryNodeDiff::TitleChanged) res << "title";
+    if (changes & StoryNodeDiff::TextChanged)  res << "text";
+    if (changes & StoryNodeDiff::ArcsChanged)  res << "arcs";
+    return res.join(", ");
+}
@@ -0,0 +1,90 @@
+#ifndef STORYDIFF_H
+#define STORYDIFF_H
+
+#include <QString>
+
+#include <vector>
+#include <cstddef>
+#include <limits>
+
+#include "story.h"
+
+// structural comparison and three-way merging of versions of a story.
+// nodes are matched by uid (not index), so reordering, inserting and erasing nodes don't show up as changes.
+// each node is reduced to 64-bit content fingerprints (title, text, arcs) and matched through a hash table,
+// so the cost is linear in the size of the maps. uids must be unique within each map.
+// arcs are compared by the uid of their dest (terminal arcs all compare equal), in order, as a single list.
+// node text must be resident (maps loaded with loadStory(), not loadStoryStructure()).
+
+// marks a node index that doesn't exist (e.g. the old index of an added node)
+constexpr std::size_t NoNode = std::numeric_limits<std::size_t>::max();
+
+// the differences in one node between two versions of a story
+struct StoryNodeDiff
+{
+    // the ways a node can differ (bit flags)
+    enum Change : unsigned
+    {
+        Added        = 1 << 0,
+        Removed      = 1 << 1,
+        Moved        = 1 << 2, // its position changed
+        TitleChanged = 1 << 3,
+        TextChanged  = 1 << 4,
+        ArcsChanged  = 1 << 5, // any arc was added, removed, retargeted or edited
+    };
+
+    quint64 uid;
+    unsigned changes;      // the Change flags that apply
+    std::size_t old_index; // the node's index in the old version (NoNode if it was added)
+    std::size_t new_index; // the node's index in the new version (NoNode if it was removed)
+};
+
+// a node that was changed in conflicting ways by both sides of a merge
+struct StoryConflict
+{
+    quint64 uid;
+    unsigned changes; // the StoryNodeDiff::Change flags changed differently on each side (Removed if one side removed it and the other edited it)
+};
+
+// the result of mergeStories()
+struct StoryMerge
+{
+    StoryMap map; // the merged story
+    std::vector<StoryConflict> conflicts;
+
+    std::size_t dropped_arcs = 0; // arcs dropped because the node they led to was removed
+};
+
+// returns the differences between two versions of a story (one entry per changed node).
+// removed and changed nodes are listed in the order of <before>, followed by added nodes in the order of <after>.
+std::vector<StoryNodeDiff> diffStories(const StoryMap &before, const StoryMap &after);
+
+// merges the changes made by <ours> and <theirs> to the common ancestor <base>.
+// each field of a node (position, title, text, arcs) is merged separately: a field changed on only one side takes
+// that side's value. fields changed differently on both sides keep our value and are reported as conflicts, as are
+// nodes removed on one side and edited on the other (which are kept).
+// the merged map keeps the order of <ours>, followed by the nodes only <theirs> added. node groups are taken from
+// <ours> (so the merged map goes with our group table) - nodes only <theirs> has are ungrouped.
+StoryMerge mergeStories(const StoryMap &base, const StoryMap &ours, const StoryMap &theirs);
+
+// what patchStory() did to the map (indices into the patched map unless noted)
+struct StoryPatch
+{
+    std::vector<std::size_t> erased;     // the removed nodes (sorted, indices as they were before the patch)
+    std::size_t first_added = 0;         // the added nodes run from here to the end of the map
+    std::vector<std::size_t> changed;    // the nodes whose position, title, text or arcs were updated
+    std::vector<std::size_t> retargeted; // other nodes whose terminal arcs were moved past the added nodes
+};
+
+// brings <live> up to date with <updated> in place, given their differences <diff> (from diffStories(live, updated)).
+// only the nodes in the diff are touched: removed nodes are erased in one pass, changed nodes are updated where they are,
+// and added nodes are appended (with a single reserve), so nodes keep their indices apart from the shift past erased ones.
+// the map's state() is remapped the same way (back to the start if its node was removed).
+// the group column is taken from <updated> for every node, so the map goes with <updated>'s group table.
+// node text must be resident in both maps, as for diffStories().
+StoryPatch patchStory(StoryMap &live, const StoryMap &updated, const std::vector<StoryNodeDiff> &diff);
+
+// returns a readable description of a set of StoryNodeDiff::Change flags (e.g. "moved, text")
+QString describeChanges(unsigned changes);
+
+#endif // STORYDIFF_H
@@ -0,0 +1,404 @@
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+#include "storyio.h"
+#include "storytextpager.h"
+
+// -- format -- //
+
+// version 1: header, then each node (point, title, text) followed by its arcs (dest, text, weight)
+// version 2: as version 1, with arc conditions and effects
+// version 3: header, then all node texts as raw utf-8, then the structure (as version 2, but each node
+//            refers to its text by offset/size instead of containing it), then the structure offset (quint64).
+//            this lets the structure be loaded without reading any text.
+// version 4: as version 3, with each node's group (after its position) and the group table after the last node
+// version 5: as version 4, with each node's uid (after its group). older files get uids from their node indices
+//            (index + 1), so copies of the same old file still agree on node identity.
+
+constexpr quint32 StoryMagic = 0x55434853; // "UCHS"
+constexpr quint32 StoryVersion = 5;        // the current format version
+
+constexpr qint64 StoryHeaderSize = 8;  // size of the header (magic and version)
+constexpr qint64 StoryTrailerSize = 8; // size of the trailer (structure offset)
+
+// -- saving -- //
+
+bool saveStory(const StoryMap &map, QIODevice &device, StoryTextPager *pager, const std::vector<StoryGroup> *groups)
+{
+    QDataStream out(&device);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    // write the header
+    out << StoryMagic << StoryVersion;
+
+    // write all the bodies, recording where they went (the device may be sequential, so keep our own position)
+    std::vector<std::pair<qint64, quint32>> bodies;
+    bodies.reserve(map.size());
+
+    qint64 pos = StoryHeaderSize;
+    for (const auto &node : map)
+    {
+        QByteArray body = (pager ? pager->text(node.data) : node.data.text).toUtf8();
+        if (device.write(body) != body.size()) return false;
+
+        bodies.emplace_back(pos, quint32(body.size()));
+        pos += body.size();
+    }
+
+    // write the structure: each node followed by its arcs
+    const qint64 structure = pos;
+    out << quint64(map.size());
+    for (std::size_t i = 0; i < map.size(); ++i)
+    {
+        const auto &node = map[i];
+        out << map.columns().point(i) << quint32(groups ? map.columns().group[i] : NoGroup) << node.data.uid
+            << node.data.title << bodies[i].first << bodies[i].second;
+
+        out << quint32(node.arcs.size());
+        for (const auto &arc : node.arcs)
+            out << quint64(arc.dest) << arc.data.text << arc.data.weight << arc.data.condition << arc.data.effect;
+    }
+
+    // write the group table
+    out << quint32(groups ? groups->size() : 0);
+    if (groups) for (const auto &group : *groups) out << group.title << group.point << group.collapsed << group.parent;
+
+    // write the trailer
+    out << structure;
+
+    return out.status() == QDataStream::Ok;
+}
+bool saveStory(const StoryMap &map, const QString &path, StoryTextPager *pager, const std::vector<StoryGroup> *groups)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    if (!saveStory(map, file, pager, groups)) { file.cancelWriting(); return false; }
+
+    return file.commit();
+}
+
+// -- loading -- //
+
+// reads the structure of a story (everything, for versions before 3) from <in>.
+// for version 3 and up, node text is left on disk (body_offset/body_size are set instead).
+static bool readStructure(QDataStream &in, quint32 version, StoryMap &res, std::vector<StoryGroup> &groups)
+{
+    QIODevice &device = *in.device();
+
+    quint64 count;
+    in >> count;
+    if (in.status() != QDataStream::Ok) return false;
+
+    // sanity check the count before trusting it for allocation (every node takes well over a byte).
+    // sequential devices can't say how much is left, so there the nodes are just added as they're read.
+    if (!device.isSequential() && count > quint64(device.size() - device.pos())) return false;
+
+    if (!device.isSequential()) res.reserve(std::size_t(count));
+
+    StoryMap::Node node;
+    StoryMap::Arc arc;
+    QPointF point;
+    quint32 group = NoGroup;
+    for (quint64 i = 0; i < count; ++i)
+    {
+        in >> point;
+        if (version >= 4) in >> group;
+        if (version >= 5) in >> node.data.uid;
+        else node.data.uid = i + 1;
+        in >> node.data.title;
+        if (version >= 3) in >> node.data.body_offset >> node.data.body_size;
+        else in >> node.data.text;
+
+        quint32 arc_count;
+        in >> arc_count;
+        if (in.status() != QDataStream::Ok) return false;
+
+        // as for the node count (every arc takes well over a byte)
+        if (!device.isSequential() && arc_count > quint64(device.size() - device.pos())) return false;
+
+        node.arcs.clear();
+        if (!device.isSequential()) node.arcs.reserve(arc_count);
+        for (quint32 j = 0; j < arc_count; ++j)
+        {
+            quint64 dest;
+            in >> dest >> arc.data.text >> arc.data.weight;
+            if (version >= 2) in >> arc.data.condition >> arc.data.effect;
+            arc.dest = std::size_t(dest);
+
+            node.arcs.push_back(arc);
+        }
+
+        if (in.status() != QDataStream::Ok) return false;
+        if (node.data.uid == 0) node.data.uid = newNodeUid(); // saved before it was assigned one
+        res.push_back(node);
+        res.columns().point(res.size() - 1, point);
+        res.columns().group[res.size() - 1] = group;
+    }
+
+    // read the group table
+    groups.clear();
+    if (version >= 4)
+    {
+        quint32 group_count;
+        in >> group_count;
+        if (in.status() != QDataStream::Ok || (!device.isSequential() && group_count > quint64(device.size()))) return false;
+
+        groups.resize(group_count);
+        for (auto &g : groups) in >> g.title >> g.point >> g.collapsed >> g.parent;
+        if (in.status() != QDataStream::Ok) return false;
+
+        // every group reference must be valid
+        for (std::uint32_t g : res.columns().group) if (g != NoGroup && g >= group_count) return false;
+        for (const auto &g : groups) if (g.parent != NoGroup && g.parent >= group_count) return false;
+    }
+
+    res.state() = 0;
+    return true;
+}
+
+// reads the header and structure of a story from the device into <res>. sets <version> to the file's format version.
+static bool readStory(QIODevice &device, StoryMap &res, std::vector<StoryGroup> &groups, quint32 &version)
+{
+    QDataStream in(&device);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    // read and validate the header
+    quint32 magic;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != StoryMagic || version < 1 || version > StoryVersion) return false;
+
+    // the structure of newer versions is found via the trailer
+    if (version >= 3)
+    {
+        if (device.isSequential() || device.size() < StoryHeaderSize + StoryTrailerSize) return false;
+
+        qint64 structure;
+        if (!device.seek(device.size() - StoryTrailerSize)) return false;
+        in >> structure;
+        if (in.status() != QDataStream::Ok || structure < StoryHeaderSize || !device.seek(structure)) return false;
+    }
+
+    return readStructure(in, version, res, groups);
+}
+
+// stores a successfully read story (and its groups, if they were asked for)
+static void acceptStory(StoryMap &map, StoryMap &res, std::vector<StoryGroup> *groups, std::vector<StoryGroup> &res_groups)
+{
+    // without the group table the group column would dangle
+    if (groups) *groups = std::move(res_groups);
+    else std::fill(res.columns().group.begin(), res.columns().group.end(), NoGroup);
+
+    map = std::move(res);
+}
+
+bool loadStory(StoryMap &map, QIODevice &device, std::vector<StoryGroup> *groups)
+{
+    // read into a temporary so a bad file doesn't clobber the map
+    StoryMap res;
+    std::vector<StoryGroup> res_groups;
+    quint32 version;
+    if (!readStory(device, res, res_groups, version)) return false;
+
+    // pull in all the text that was left on disk
+    if (version >= 3)
+    {
+        for (auto &node : res)
+        {
+            if (!device.seek(node.data.body_offset)) return false;
+
+            QByteArray body = device.read(qint64(node.data.body_size));
+            if (body.size() != qint64(node.data.body_size)) return false;
+
+            node.data.text = QString::fromUtf8(body);
+            node.data.body_offset = -1;
+            node.data.body_size = 0;
+        }
+    }
+
+    acceptStory(map, res, groups, res_groups);
+    return true;
+}
+bool loadStory(StoryMap &map, const QString &path, std::vector<StoryGroup> *groups)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    return loadStory(map, file, groups);
+}
+
+bool loadStoryStructure(StoryMap &map, QIODevice &device, std::vector<StoryGroup> *groups)
+{
+    StoryMap res;
+    std::vector<StoryGroup> res_groups;
+    quint32 version;
+    if (!readStory(device, res, res_groups, version)) return false;
+
+    acceptStory(map, res, groups, res_groups);
+    return true;
+}
+bool loadStoryStructure(StoryMap &map, const QString &path, std::vector<StoryGroup> *groups)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    return loadStoryStructure(map, file, groups);
+}
+
+// -- subgraphs -- //
+
+// header (magic and version), then the node count, then each node (point relative to the center, title, text)
+// followed by its arcs (kind, then the local index for internal arcs or the uid for external ones, then as version 5).
+// there are no node uids - pasted nodes always get new ones.
+
+constexpr quint32 SubgraphMagic = 0x55434847; // "UCHG"
+constexpr quint32 SubgraphVersion = 1;
+
+// how an arc in a subgraph is stored
+enum SubgraphArc : quint8 { InternalArc, ExternalArc, TerminalArc };
+
+QByteArray saveSubgraph(const StoryMap &map, const std::vector<std::size_t> &nodes, StoryTextPager *pager)
+{
+    QByteArray res;
+    QDataStream out(&res, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    // the place of each node in the subgraph
+    std::unordered_map<std::size_t, quint64> local;
+    local.reserve(nodes.size());
+    QPointF center;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        local.emplace(nodes[i], quint64(i));
+        center += map.columns().point(nodes[i]);
+    }
+    if (!nodes.empty()) center /= qreal(nodes.size());
+
+    out << SubgraphMagic << SubgraphVersion << quint64(nodes.size());
+    for (std::size_t index : nodes)
+    {
+        const auto &node = map[index];
+        out << map.columns().point(index) - center << node.data.title << (pager ? pager->text(node.data) : node.data.text);
+
+        out << quint32(node.arcs.size());
+        for (const auto &arc : node.arcs)
+        {
+            auto i = local.find(arc.dest);
+            if (i != local.end()) out << quint8(InternalArc) << i->second;
+            else if (arc.dest < map.size()) out << quint8(ExternalArc) << map[arc.dest].data.uid;
+            else out << quint8(TerminalArc);
+
+            out << arc.data.text << arc.data.weight << arc.data.condition << arc.data.effect;
+        }
+    }
+
+    return res;
+}
+
+std::size_t loadSubgraph(StoryMap &map, const QByteArray &data, QPointF center, bool keep_external)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    quint64 count;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != SubgraphMagic || version != SubgraphVersion) return 0;
+
+    // sanity check the count before trusting it for allocation
+    if (count == 0 || count > quint64(data.size())) return 0;
+
+    // marks arcs while reading (resolved below)
+    constexpr std::size_t External = std::size_t(-1), Terminal = std::size_t(-2);
+
+    // read everything before touching the map, so bad data leaves it alone
+    std::vector<StoryMap::Node> nodes(std::size_t(count));
+    std::vector<QPointF> points(std::size_t(count));
+    std::vector<quint64> external_uids; // the uid of each external arc, in the order they were read
+
+    StoryMap::Arc arc;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        auto &node = nodes[i];
+        in >> points[i] >> node.data.title >> node.data.text;
+
+        quint32 arc_count;
+        in >> arc_count;
+        if (in.status() != QDataStream::Ok || arc_count > quint64(data.size())) return 0;
+
+        node.arcs.reserve(arc_count);
+        for (quint32 j = 0; j < arc_count; ++j)
+        {
+            quint8 kind;
+            in >> kind;
+            if (kind == InternalArc)
+            {
+                quint64 dest;
+                in >> dest;
+                if (dest >= count) return 0;
+                arc.dest = std::size_t(dest);
+            }
+            else if (kind == ExternalArc)
+            {
+                quint64 uid;
+                in >> uid;
+                external_uids.push_back(uid);
+                arc.dest = External;
+            }
+            else if (kind == TerminalArc) arc.dest = Terminal;
+            else return 0;
+
+            in >> arc.data.text >> arc.data.weight >> arc.data.condition >> arc.data.effect;
+            node.arcs.push_back(arc);
+        }
+        if (in.status() != QDataStream::Ok) return 0;
+    }
+
+    // find the targets of external arcs (by uid) among the existing nodes
+    std::unordered_map<quint64, std::size_t> uids;
+    if (keep_external && !external_uids.empty())
+    {
+        uids.reserve(map.size());
+        for (std::size_t i = 0; i < map.size(); ++i) uids.emplace(map[i].data.uid, i);
+    }
+
+    // remap all the arcs in one pass - internal arcs are offset past the existing nodes
+    const std::size_t base = map.size(), end = base + nodes.size();
+    std::size_t next_external = 0;
+    for (auto &node : nodes)
+    {
+        std::size_t kept = 0;
+        for (std::size_t a = 0; a < node.arcs.size(); ++a)
+        {
+            auto &arc = node.arcs[a];
+            if (arc.dest == Terminal) arc.dest = end;
+            else if (arc.dest == External)
+            {
+                auto i = uids.find(external_uids[next_external++]);
+                if (i == uids.end()) continue;
+                arc.dest = i->second;
+            }
+            else arc.dest += base;
+
+            if (kept != a) node.arcs[kept] = std::move(arc);
+            ++kept;
+        }
+        node.arcs.erase(node.arcs.begin() + std::ptrdiff_t(kept), node.arcs.end());
+    }
+
+    // append the nodes (making room for all of them at once)
+    map.reserve(end);
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i].data.uid = newNodeUid();
+        map.emplace_back(std::move(nodes[i]));
+        map.columns().point(base + i, center + points[i]);
+    }
+
+    return nodes.size();
+}
@@ -0,0 +1,56 @@
+#ifndef STORYIO_H
+#define STORYIO_H
+
+#include <QIODevice>
+#include <QString>
+#include <QByteArray>
+#include <QPointF>
+
+#include <vector>
+#include <cstddef>
+
+#include "story.h"
+
+class StoryTextPager;
+
+// reading and writing story maps in the uchoose binary format (a versioned QDataStream).
+// node indices are stored as-is, so arcs (including terminal arcs) round-trip exactly.
+// arc conditions/effects are stored as source - loaded maps must be compiled with compileStory() before they are played.
+// node text is stored apart from the rest of the map so the structure can be loaded on its own (see loadStoryStructure()).
+// the node groups (see StoryGroup) are optional - maps loaded without them have every node ungrouped.
+
+// writes the map (and its <groups>, if non-null) to the device.
+// text of nodes whose body is on disk is fetched through <pager> (if non-null). returns true on success.
+bool saveStory(const StoryMap &map, QIODevice &device, StoryTextPager *pager = nullptr, const std::vector<StoryGroup> *groups = nullptr);
+// writes the map to the file at <path> (replaced atomically), as above. returns true on success.
+bool saveStory(const StoryMap &map, const QString &path, StoryTextPager *pager = nullptr, const std::vector<StoryGroup> *groups = nullptr);
+
+// reads a map (including all node text) from the device, and its groups into <groups> (if non-null).
+// on failure returns false and leaves <map> and <groups> unchanged.
+// files from the current format version require a random access device.
+bool loadStory(StoryMap &map, QIODevice &device, std::vector<StoryGroup> *groups = nullptr);
+// reads a map (including all node text) from the file at <path>, as above.
+bool loadStory(StoryMap &map, const QString &path, std::vector<StoryGroup> *groups = nullptr);
+
+// as loadStory(), but leaves node text on disk (nodes get body_offset/body_size instead) to be read by a StoryTextPager.
+// files from older format versions have no separate text, and are loaded in full.
+bool loadStoryStructure(StoryMap &map, QIODevice &device, std::vector<StoryGroup> *groups = nullptr);
+bool loadStoryStructure(StoryMap &map, const QString &path, std::vector<StoryGroup> *groups = nullptr);
+
+// -- subgraphs (copy/paste) -- //
+
+// the mime type of saveSubgraph() data on the clipboard
+constexpr const char *SubgraphMimeType = "application/x-uchoose-subgraph";
+
+// writes the nodes at the given indices (and their arcs) in a compact form for pasting with loadSubgraph().
+// positions are stored relative to the nodes' center. arcs within the set refer to nodes by their place in it, and arcs
+// to nodes outside it by uid. text of nodes whose body is on disk is fetched through <pager> (if non-null).
+QByteArray saveSubgraph(const StoryMap &map, const std::vector<std::size_t> &nodes, StoryTextPager *pager = nullptr);
+
+// appends the nodes from saveSubgraph() data to the map (with a single reserve), centered on <center>, with new uids.
+// arcs within the subgraph are remapped to the new nodes in one pass. arcs to nodes outside it are kept if <keep_external>
+// is set and a node with that uid is in the map, and dropped otherwise. terminal arcs stay terminal.
+// arc scripts are not compiled. returns the number of nodes added - on failure returns 0 and leaves the map unchanged.
+std::size_t loadSubgraph(StoryMap &map, const QByteArray &data, QPointF center, bool keep_external);
+
+#endif // STORYIO_H
@@ -0,0 +1,71 @@
+#include "storytextpager.h"
+
+// -- accessors -- //
+
+void StoryTextPager::budget(std::size_t bytes)
+{
+    _budget = bytes;
+    trim();
+}
+
+// -- interface -- //
+
+bool StoryTextPager::open(const QString &path)
+{
+    close();
+
+    file.setFileName(path);
+    return file.open(QIODevice::ReadOnly);
+}
+void StoryTextPager::close()
+{
+    file.close();
+
+    lru.clear();
+    lookup.clear();
+    _used = 0;
+}
+
+QString StoryTextPager::text(const StoryNode &node)
+{
+    // resident text is returned as-is
+    if (node.body_offset < 0) return node.text;
+
+    // an empty body shares its offset with the next node's body, so it must never reach the cache
+    if (node.body_size == 0) return QString();
+
+    // if it's cached, move it to the front
+    auto i = lookup.find(node.body_offset);
+    if (i != lookup.end())
+    {
+        lru.splice(lru.begin(), lru, i->second);
+        return i->second->second;
+    }
+
+    // otherwise read it from disk
+    if (!file.isOpen() || !file.seek(node.body_offset)) return QString();
+    QString res = QString::fromUtf8(file.read(qint64(node.body_size)));
+
+    // add it to the cache
+    lru.emplace_front(node.body_offset, res);
+    lookup.emplace(node.body_offset, lru.begin());
+    _used += std::size_t(res.size()) * sizeof(QChar);
+    trim();
+
+    return res;
+}
+
+// -- helpers -- //
+
+void StoryTextPager::trim()
+{
+    // always keep the most recent entry, even if it alone is over budget
+    while (_used > _budget && lru.size() > 1)
+    {
+        auto &last = lru.back();
+
+        _used -= std::size_t(last.second.size()) * sizeof(QChar);
+        lookup.erase(last.first);
+        lru.pop_back();
+    }
+}
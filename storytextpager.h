@@ -0,0 +1,69 @@
+#ifndef STORYTEXTPAGER_H
+#define STORYTEXTPAGER_H
+
+#include <QFile>
+#include <QString>
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+
+#include "story.h"
+
+// serves node text that was left on disk by loadStoryStructure().
+// bodies are read on demand from the story file and kept in an lru cache bounded by a memory budget.
+class StoryTextPager
+{
+private: // -- types -- //
+
+    typedef std::list<std::pair<qint64, QString>> lru_t; // (body offset, text), most recently used first
+
+private: // -- data -- //
+
+    QFile file; // the story file the bodies are read from
+
+    std::size_t _budget; // the maximum memory to use for cached text (bytes)
+    std::size_t _used = 0; // the memory currently used by cached text (bytes)
+
+    lru_t lru;
+    std::unordered_map<qint64, lru_t::iterator> lookup; // body offset -> cache entry (only non-empty bodies, whose offsets are unique)
+
+public: // -- ctor / dtor / asgn -- //
+
+    // constructs a closed pager with the given cache budget (bytes)
+    explicit StoryTextPager(std::size_t budget = 64 * 1024 * 1024) : _budget(budget) {}
+
+    StoryTextPager(const StoryTextPager&) = delete;
+    StoryTextPager &operator=(const StoryTextPager&) = delete;
+
+public: // -- accessors -- //
+
+    // returns true iff the pager has a story file open
+    bool isOpen() const { return file.isOpen(); }
+
+    // gets/sets the cache budget (bytes). shrinking the budget evicts immediately.
+    std::size_t budget() const { return _budget; }
+    void budget(std::size_t bytes);
+
+    // gets the memory currently used by cached text (bytes)
+    std::size_t used() const { return _used; }
+
+public: // -- interface -- //
+
+    // opens the story file to read bodies from (closing any previous one and clearing the cache). returns true on success.
+    bool open(const QString &path);
+    // closes the story file and clears the cache
+    void close();
+
+    // gets the text of the given node - either the text it holds or (if its body is on disk) the paged-in body.
+    // returns an empty string if the body can't be read.
+    QString text(const StoryNode &node);
+
+private: // -- helpers -- //
+
+    // evicts least recently used entries until we're within budget
+    void trim();
+};
+
+#endif // STORYTEXTPAGER_H
@@ -0,0 +1,314 @@
+#include <QStringList>
+#include <QHash>
+#include <QMetaObject>
+
+#include <algorithm>
+#include <utility>
+
+#include "storyvalidator.h"
+
+QString describeDiagnostic(unsigned kinds)
+{
+    QStringList res;
+    if (kinds & StoryDiagnostic::DanglingArc)  res << "arc to a missing node";
+    if (kinds & StoryDiagnostic::Orphan)       res << "orphaned";
+    if (kinds & StoryDiagnostic::EmptyText)    res << "empty text";
+    if (kinds & StoryDiagnostic::DuplicateArc) res << "duplicate arcs";
+    return res.join(", ");
+}
+
+// ----------------- //
+
+// -- ctor / dtor -- //
+
+// ----------------- //
+
+StoryValidator::StoryValidator(QObject *parent) :
+    QObject(parent)
+{
+    worker = std::thread(&StoryValidator::run, this);
+}
+StoryValidator::~StoryValidator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// --------------- //
+
+// -- mutations -- //
+
+// --------------- //
+
+StoryValidator::NodeFacts StoryValidator::facts(const StoryMap::Node &node)
+{
+    NodeFacts res;
+
+    // text left on disk is only known by its size
+    res.empty_text = node.data.body_offset < 0 ? node.data.text.isEmpty() : node.data.body_size == 0;
+
+    res.arcs.reserve(node.arcs.size());
+    for (const auto &arc : node.arcs) res.arcs.push_back({arc.dest, qHash(arc.data.text)});
+
+    return res;
+}
+
+void StoryValidator::post(Edit edit)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // a reset makes everything before it moot
+        if (edit.kind == Edit::Reset) queue.clear();
+        queue.push_back(std::move(edit));
+    }
+    wake.notify_one();
+}
+
+void StoryValidator::reset(const StoryMap &map)
+{
+    Edit edit;
+    edit.kind = Edit::Reset;
+    edit.nodes.reserve(map.size());
+    for (const auto &node : map) edit.nodes.push_back(facts(node));
+
+    post(std::move(edit));
+}
+void StoryValidator::update(std::size_t index, const StoryMap::Node &node)
+{
+    Edit edit;
+    edit.kind = Edit::Update;
+    edit.index = index;
+    edit.nodes.push_back(facts(node));
+
+    post(std::move(edit));
+}
+void StoryValidator::insert(const StoryMap &map, std::size_t first)
+{
+    Edit edit;
+    edit.kind = Edit::Insert;
+    edit.nodes.reserve(map.size() - std::min(first, map.size()));
+    for (std::size_t i = first; i < map.size(); ++i) edit.nodes.push_back(facts(map[i]));
+
+    post(std::move(edit));
+}
+void StoryValidator::erase(std::vector<std::size_t> indices)
+{
+    Edit edit;
+    edit.kind = Edit::Erase;
+    edit.indices = std::move(indices);
+
+    post(std::move(edit));
+}
+
+std::vector<StoryDiagnostic> StoryValidator::diagnostics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return published;
+}
+
+// ------------ //
+
+// -- worker -- //
+
+// ------------ //
+
+void StoryValidator::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (stopping) return;
+
+        // take everything queued so far and apply it as one batch (without holding the lock)
+        std::deque<Edit> batch;
+        batch.swap(queue);
+        lock.unlock();
+
+        bool full = false;
+        std::vector<std::size_t> touched;
+        for (auto &edit : batch) apply(edit, full, touched);
+
+        // re-check just the nodes that were affected (unless the whole map needs it)
+        if (full) recount();
+        else for (std::size_t i : touched) evaluate(i);
+
+        std::vector<StoryDiagnostic> res;
+        res.reserve(flagged.size());
+        for (std::size_t i : flagged) res.push_back({i, flags[i]});
+
+        // publish the results
+        lock.lock();
+        published.swap(res);
+        QMetaObject::invokeMethod(this, "changed", Qt::QueuedConnection);
+    }
+}
+
+void StoryValidator::apply(Edit &edit, bool &full, std::vector<std::size_t> &touched)
+{
+    switch (edit.kind)
+    {
+    case Edit::Reset:
+        nodes = std::move(edit.nodes);
+        full = true;
+        break;
+
+    case Edit::Update:
+        if (edit.index >= nodes.size()) break;
+
+        if (!full) removeArcs(edit.index, touched);
+        nodes[edit.index] = std::move(edit.nodes.front());
+        if (!full) addArcs(edit.index, touched);
+        touched.push_back(edit.index);
+        break;
+
+    case Edit::Insert:
+        for (auto &node : edit.nodes)
+        {
+            const std::size_t n = nodes.size();
+            nodes.push_back(std::move(node));
+            in_degree.push_back(0);
+            flags.push_back(0);
+            if (full) continue;
+
+            // arcs that ended the story by pointing one past the end now lead to the new node
+            auto i = beyond.find(n);
+            if (i != beyond.end())
+            {
+                in_degree[n] = i->second.size();
+                beyond.erase(i);
+            }
+            // and arcs one further along become the usual terminal arcs (no longer dangling)
+            auto j = beyond.find(n + 1);
+            if (j != beyond.end()) touched.insert(touched.end(), j->second.begin(), j->second.end());
+
+            addArcs(n, touched);
+            touched.push_back(n);
+        }
+        break;
+
+    case Edit::Erase:
+    {
+        // the indices shift for everything after the first erased node, so just remap and recount
+        auto &erased = edit.indices;
+        std::sort(erased.begin(), erased.end());
+        erased.erase(std::unique(erased.begin(), erased.end()), erased.end());
+        erased.erase(std::lower_bound(erased.begin(), erased.end(), nodes.size()), erased.end());
+        if (erased.empty()) break;
+
+        std::vector<char> gone(nodes.size(), 0);
+        for (std::size_t i : erased) gone[i] = 1;
+
+        // as AdventureMap::erase() - arcs to erased nodes are removed, and later dests shift down
+        for (auto &node : nodes)
+        {
+            std::size_t kept = 0;
+            for (const auto &arc : node.arcs)
+            {
+                if (arc.dest < gone.size() && gone[arc.dest]) continue;
+
+                ArcFacts moved = arc;
+                moved.dest -= std::size_t(std::lower_bound(erased.begin(), erased.end(), arc.dest) - erased.begin());
+                node.arcs[kept++] = moved;
+            }
+            node.arcs.resize(kept);
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < nodes.size(); ++i) if (!gone[i]) nodes[kept++] = std::move(nodes[i]);
+        nodes.resize(kept);
+
+        full = true;
+        break;
+    }
+    }
+}
+
+void StoryValidator::addArcs(std::size_t index, std::vector<std::size_t> &touched)
+{
+    for (const auto &arc : nodes[index].arcs)
+    {
+        if (arc.dest == index) continue; // a node leading to itself doesn't stop it being orphaned
+
+        if (arc.dest < nodes.size())
+        {
+            ++in_degree[arc.dest];
+            touched.push_back(arc.dest);
+        }
+        else beyond[arc.dest].push_back(index);
+    }
+}
+void StoryValidator::removeArcs(std::size_t index, std::vector<std::size_t> &touched)
+{
+    for (const auto &arc : nodes[index].arcs)
+    {
+        if (arc.dest == index) continue;
+
+        if (arc.dest < nodes.size())
+        {
+            --in_degree[arc.dest];
+            touched.push_back(arc.dest);
+        }
+        else
+        {
+            auto i = beyond.find(arc.dest);
+            if (i == beyond.end()) continue;
+
+            auto &owners = i->second;
+            auto j = std::find(owners.begin(), owners.end(), index);
+            if (j != owners.end()) owners.erase(j);
+            if (owners.empty()) beyond.erase(i);
+        }
+    }
+}
+
+void StoryValidator::recount()
+{
+    const std::size_t n = nodes.size();
+
+    in_degree.assign(n, 0);
+    beyond.clear();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        for (const auto &arc : nodes[i].arcs)
+        {
+            if (arc.dest == i) continue;
+
+            if (arc.dest < n) ++in_degree[arc.dest];
+            else beyond[arc.dest].push_back(i);
+        }
+    }
+
+    flags.assign(n, 0);
+    flagged.clear();
+    for (std::size_t i = 0; i < n; ++i) evaluate(i);
+}
+
+void StoryValidator::evaluate(std::size_t index)
+{
+    if (index >= nodes.size()) return;
+
+    const NodeFacts &node = nodes[index];
+    unsigned res = 0;
+
+    if (node.empty_text) res |= StoryDiagnostic::EmptyText;
+    if (index != 0 && in_degree[index] == 0) res |= StoryDiagnostic::Orphan;
+
+    for (std::size_t a = 0; a < node.arcs.size(); ++a)
+    {
+        if (node.arcs[a].dest > nodes.size()) res |= StoryDiagnostic::DanglingArc;
+
+        // nodes only have a handful of arcs, so compare them pairwise
+        for (std::size_t b = a + 1; b < node.arcs.size(); ++b)
+            if (node.arcs[a].dest == node.arcs[b].dest && node.arcs[a].label == node.arcs[b].label) res |= StoryDiagnostic::DuplicateArc;
+    }
+
+    flags[index] = res;
+    if (res != 0) flagged.insert(index);
+    else flagged.erase(index);
+}
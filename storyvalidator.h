@@ -0,0 +1,138 @@
+#ifndef STORYVALIDATOR_H
+#define STORYVALIDATOR_H
+
+#include <QObject>
+#include <QString>
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+
+#include "story.h"
+
+// a problem found with a node
+struct StoryDiagnostic
+{
+    // the kinds of problem (bit flags)
+    enum Kind : unsigned
+    {
+        DanglingArc  = 1 << 0, // an arc leads past the end of the map (dest > size - dest == size is the usual terminal arc)
+        Orphan       = 1 << 1, // no other node leads here (the first node is the start, so it never counts)
+        EmptyText    = 1 << 2,
+        DuplicateArc = 1 << 3, // two arcs with the same dest and text
+    };
+
+    std::size_t node; // the node's index
+    unsigned kinds;   // the Kind flags that apply
+};
+
+// returns a readable description of a set of StoryDiagnostic::Kind flags (e.g. "orphaned, empty text")
+QString describeDiagnostic(unsigned kinds);
+
+// checks a story for problems on a worker thread, kept up to date as the map is edited.
+// the owner reports each mutation (reset/update/insert/erase) as it happens - these only take a snapshot of the node(s)
+// involved and queue it, so they never wait on the worker. the worker keeps its own mirror of the map's structure
+// (arc dests and in-degrees) and re-checks just the nodes each edit affects, then publishes the results and emits changed().
+class StoryValidator : public QObject
+{
+    Q_OBJECT
+
+private: // -- types -- //
+
+    // the part of an arc the checks look at
+    struct ArcFacts
+    {
+        std::size_t dest;
+        uint label; // hash of the arc text
+    };
+    // the part of a node the checks look at
+    struct NodeFacts
+    {
+        bool empty_text = false;
+        std::vector<ArcFacts> arcs;
+    };
+
+    // a queued mutation
+    struct Edit
+    {
+        enum Kind { Reset, Update, Insert, Erase } kind;
+
+        std::size_t index = 0;            // the updated node (Update)
+        std::vector<NodeFacts> nodes;     // the new node(s) (Reset, Update, Insert)
+        std::vector<std::size_t> indices; // the erased nodes (Erase)
+    };
+
+private: // -- data -- //
+
+    mutable std::mutex mutex;         // guards everything shared with the worker (below)
+    std::condition_variable wake;     // signals the worker that there are edits (or it should stop)
+    std::deque<Edit> queue;           // the edits not yet applied
+    bool stopping = false;            // tells the worker to finish
+    std::vector<StoryDiagnostic> published; // the latest results
+
+    std::thread worker;
+
+    // worker state (only touched by the worker thread)
+    std::vector<NodeFacts> nodes;     // the mirror of the map
+    std::vector<std::size_t> in_degree; // the number of arcs into each node (from other nodes)
+    std::unordered_map<std::size_t, std::vector<std::size_t>> beyond; // dest (>= size) -> the node of each arc going there
+    std::vector<unsigned> flags;      // the diagnostic flags of each node
+    std::set<std::size_t> flagged;    // the nodes with any flags
+
+public: // -- ctor / dtor / asgn -- //
+
+    // starts the worker (with an empty map)
+    explicit StoryValidator(QObject *parent = nullptr);
+    // stops the worker (discarding any queued edits)
+    virtual ~StoryValidator() override;
+
+public: // -- mutations (call from the owning thread) -- //
+
+    // the whole map was replaced
+    void reset(const StoryMap &map);
+    // the node at <index> was edited
+    void update(std::size_t index, const StoryMap::Node &node);
+    // the nodes from <first> to the end of the map were appended to it
+    void insert(const StoryMap &map, std::size_t first);
+    // the nodes at the given indices were erased (indices as they were before the erase, as AdventureMap::erase())
+    void erase(std::vector<std::size_t> indices);
+
+public: // -- results -- //
+
+    // returns the latest published diagnostics (sorted by node)
+    std::vector<StoryDiagnostic> diagnostics() const;
+
+signals:
+
+    // emitted (on the owning thread) when new diagnostics have been published
+    void changed();
+
+private: // -- helpers -- //
+
+    static NodeFacts facts(const StoryMap::Node &node);
+
+    // queues an edit for the worker
+    void post(Edit edit);
+
+    // the worker loop
+    void run();
+
+    // applies an edit to the mirror. incremental bookkeeping is skipped once <full> is set (everything gets recounted).
+    void apply(Edit &edit, bool &full, std::vector<std::size_t> &touched);
+
+    // adds/removes the arcs of a node to/from the in-degrees, noting the nodes whose in-degree changed
+    void addArcs(std::size_t index, std::vector<std::size_t> &touched);
+    void removeArcs(std::size_t index, std::vector<std::size_t> &touched);
+
+    // recomputes all the in-degrees and flags from scratch
+    void recount();
+    // recomputes the flags of a single node
+    void evaluate(std::size_t index);
+};
+
+#endif // STORYVALIDATOR_H
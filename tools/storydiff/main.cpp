@@ -0,0 +1,92 @@
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <cstdio>
+#include <vector>
+#include <unordered_map>
+
+#include "story.h"
+#include "storyio.h"
+#include "storydiff.h"
+
+// command line front end for diffStories() / mergeStories().
+//     storydiff OLD NEW                      lists the nodes that differ
+//     storydiff --merge BASE OURS THEIRS OUT  merges OURS and THEIRS (both descended from BASE) into OUT
+// like diff(1), exits with 0 if there are no differences (or conflicts), 1 if there are, and 2 on error.
+
+// prints a line to stdout
+static void print(const QString &line)
+{
+    std::fputs(qPrintable(line + "\n"), stdout);
+}
+// prints an error to stderr and returns the error exit code
+static int fail(const QString &msg)
+{
+    std::fputs(qPrintable("storydiff: " + msg + "\n"), stderr);
+    return 2;
+}
+
+static int usage()
+{
+    std::fputs("usage: storydiff OLD NEW\n"
+               "       storydiff --merge BASE OURS THEIRS OUT\n", stderr);
+    return 2;
+}
+
+// returns the title of the node with the given index in whichever version has it
+static QString titleOf(const StoryMap &before, const StoryMap &after, const StoryNodeDiff &diff)
+{
+    return diff.new_index != NoNode ? after[diff.new_index].data.title : before[diff.old_index].data.title;
+}
+
+static int diff(const QString &old_path, const QString &new_path)
+{
+    StoryMap before, after;
+    if (!loadStory(before, old_path)) return fail("failed to load " + old_path);
+    if (!loadStory(after, new_path)) return fail("failed to load " + new_path);
+
+    auto diffs = diffStories(before, after);
+    for (const auto &d : diffs)
+    {
+        const char *mark = d.changes & StoryNodeDiff::Added ? "+" : d.changes & StoryNodeDiff::Removed ? "-" : "~";
+        print(QString("%1 %2 \"%3\": %4").arg(mark).arg(d.uid, 16, 16, QChar('0'))
+              .arg(titleOf(before, after, d)).arg(describeChanges(d.changes)));
+    }
+
+    return diffs.empty() ? 0 : 1;
+}
+
+static int merge(const QString &base_path, const QString &ours_path, const QString &theirs_path, const QString &out_path)
+{
+    StoryMap base, ours, theirs;
+    std::vector<StoryGroup> groups; // the merged map keeps our groups
+    if (!loadStory(base, base_path)) return fail("failed to load " + base_path);
+    if (!loadStory(ours, ours_path, &groups)) return fail("failed to load " + ours_path);
+    if (!loadStory(theirs, theirs_path)) return fail("failed to load " + theirs_path);
+
+    StoryMerge res = mergeStories(base, ours, theirs);
+    if (!saveStory(res.map, out_path, nullptr, &groups)) return fail("failed to save " + out_path);
+
+    // conflicting nodes are always kept, so they can be looked up in the merged map
+    std::unordered_map<quint64, std::size_t> indices;
+    if (!res.conflicts.empty()) for (std::size_t i = 0; i < res.map.size(); ++i) indices.emplace(res.map[i].data.uid, i);
+
+    for (const auto &c : res.conflicts)
+    {
+        print(QString("conflict %1 \"%2\": %3").arg(c.uid, 16, 16, QChar('0'))
+              .arg(res.map[indices[c.uid]].data.title).arg(describeChanges(c.changes)));
+    }
+    if (res.dropped_arcs != 0) print(QString("dropped %1 arc(s) to removed nodes").arg(res.dropped_arcs));
+
+    return res.conflicts.empty() ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+
+    if (args.size() == 2) return diff(args[0], args[1]);
+    if (args.size() == 5 && args[0] == "--merge") return merge(args[1], args[2], args[3], args[4]);
+    return usage();
+}
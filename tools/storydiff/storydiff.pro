@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Command line diff / three-way merge of story files.
+# Build with qmake from this directory and run storydiff (no arguments for usage).
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = storydiff
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        main.cpp \
+    ../../story.cpp \
+    ../../storydiff.cpp \
+    ../../storyio.cpp \
+    ../../story_script.cpp \
+    ../../storytextpager.cpp
+
+HEADERS += \
+    ../../storydiff.h \
+    ../../storyio.h
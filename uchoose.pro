@@ -24,15 +24,42 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# Hot-path timers and the performance overlay are compiled in with: qmake CONFIG+=profiling
+profiling: DEFINES += UCHOOSE_PROFILING
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-    nodeeditor.cpp
+    nodeeditor.cpp \
+    searchindex.cpp \
+    storyio.cpp \
+    story_generator.cpp \
+    profiler.cpp \
+    story_script.cpp \
+    storytextpager.cpp \
+    minimap.cpp \
+    story.cpp \
+    storydiff.cpp \
+    storyvalidator.cpp \
+    arcrouter.cpp
 
 HEADERS += \
         mainwindow.h \
     adventure_map.h \
-    nodeeditor.h
+    adventure_analysis.h \
+    adventure_paths.h \
+    nodeeditor.h \
+    searchindex.h \
+    story.h \
+    storyio.h \
+    story_generator.h \
+    profiler.h \
+    story_script.h \
+    storytextpager.h \
+    minimap.h \
+    storydiff.h \
+    storyvalidator.h \
+    arcrouter.h
 
 FORMS += \
         mainwindow.ui \